@@ -0,0 +1,52 @@
+import taichi as ti
+import numpy as np
+import time
+
+N = 1024
+num_cells = 100000
+
+
+def _access_with(batched, write):
+    @ti.archs_with([ti.cpu])
+    def benchmark():
+        x = ti.field(dtype=ti.f32, shape=(N, N))
+        indices = np.random.randint(0, N, size=(num_cells, 2), dtype=np.int32)
+        values = np.random.rand(num_cells).astype(np.float32)
+
+        # Compile the accessors first
+        x.gather(indices[:1])
+        x.scatter(indices[:1], values[:1])
+        x[0, 0] = x[0, 0]
+
+        t = time.time()
+        if batched and write:
+            x.scatter(indices, values)
+        elif batched:
+            x.gather(indices)
+        elif write:
+            for k in range(num_cells):
+                x[indices[k, 0], indices[k, 1]] = values[k]
+        else:
+            for k in range(num_cells):
+                x[indices[k, 0], indices[k, 1]]
+        ti.stat_write('cells_per_second', num_cells / (time.time() - t))
+
+    return benchmark()
+
+
+# 10^5 random cells, through x[i, j] (one accessor launch and sync per cell)
+# vs. x.gather()/x.scatter() (one kernel launch)
+def benchmark_read_per_cell():
+    return _access_with(batched=False, write=False)
+
+
+def benchmark_read_gather():
+    return _access_with(batched=True, write=False)
+
+
+def benchmark_write_per_cell():
+    return _access_with(batched=False, write=True)
+
+
+def benchmark_write_scatter():
+    return _access_with(batched=True, write=True)
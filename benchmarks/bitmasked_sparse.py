@@ -0,0 +1,51 @@
+import taichi as ti
+
+
+# Struct-for over a 4096x4096 bitmasked field with 1% of its cells active.
+# Most mask words are zero and are skipped a word at a time.
+@ti.archs_with([ti.cpu, ti.cuda])
+def benchmark_bitmasked_struct_for_1_percent():
+    x = ti.field(dtype=ti.f32)
+    s = ti.field(dtype=ti.f32, shape=())
+    N = 4096
+
+    ti.root.bitmasked(ti.ij, [N, N]).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(N, N):
+            if (i * 7919 + j * 104729) % 100 == 0:
+                x[i, j] = 1
+
+    @ti.kernel
+    def reduce():
+        for i, j in x:
+            s[None] += x[i, j]
+
+    activate()
+    return ti.benchmark(reduce, repeat=10)
+
+
+# Same occupancy with a bitmasked interior node, so that listgen has to skip
+# the inactive cells.
+@ti.archs_with([ti.cpu, ti.cuda])
+def benchmark_bitmasked_listgen_1_percent():
+    x = ti.field(dtype=ti.f32)
+    s = ti.field(dtype=ti.f32, shape=())
+    N = 1024
+
+    ti.root.bitmasked(ti.ij, [N, N]).dense(ti.ij, [4, 4]).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(N, N):
+            if (i * 7919 + j * 104729) % 100 == 0:
+                x[i * 4, j * 4] = 1
+
+    @ti.kernel
+    def reduce():
+        for i, j in x:
+            s[None] += x[i, j]
+
+    activate()
+    return ti.benchmark(reduce, repeat=10)
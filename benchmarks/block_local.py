@@ -0,0 +1,97 @@
+import taichi as ti
+
+
+def _laplacian_2d_with(make_block_local):
+    @ti.archs_with([ti.cpu], make_block_local=make_block_local)
+    def benchmark():
+        x = ti.field(dtype=ti.f32)
+        y = ti.field(dtype=ti.f32)
+        N = 4096
+        block_size = 16
+
+        ti.root.pointer(ti.ij, N // block_size).dense(ti.ij,
+                                                      block_size).place(x)
+        ti.root.pointer(ti.ij, N // block_size).dense(ti.ij,
+                                                      block_size).place(y)
+
+        @ti.kernel
+        def fill():
+            for i, j in ti.ndrange((1, N - 1), (1, N - 1)):
+                x[i, j] = (i * 7 + j * 3) % 11
+
+        @ti.kernel
+        def laplacian():
+            ti.block_local(x)
+            for i, j in x:
+                y[i, j] = 4 * x[i, j] - x[i - 1, j] - x[i + 1, j] - x[
+                    i, j - 1] - x[i, j + 1]
+
+        fill()
+        return ti.benchmark(laplacian, repeat=10)
+
+    return benchmark()
+
+
+def _p2g_with(make_block_local):
+    @ti.archs_with([ti.cpu], make_block_local=make_block_local)
+    def benchmark():
+        N = 1024
+        block_size = 16
+        num_particles = N * N * 4
+
+        x = ti.Vector.field(2, dtype=ti.f32, shape=num_particles)
+        m = ti.field(dtype=ti.f32)
+        pid = ti.field(dtype=ti.i32)
+
+        block = ti.root.pointer(ti.ij, N // block_size)
+        block.dense(ti.ij, block_size).place(m)
+        block.dynamic(ti.l, block_size**2 * 64,
+                      chunk_size=block_size**2 * 8).place(pid)
+
+        @ti.kernel
+        def seed():
+            for p in x:
+                x[p] = [0.1 + 0.8 * ti.random(), 0.1 + 0.8 * ti.random()]
+
+        @ti.kernel
+        def insert():
+            for p in x:
+                base = ti.floor(x[p] * N).cast(ti.i32)
+                ti.append(pid.parent(), base, p)
+
+        @ti.kernel
+        def p2g():
+            ti.block_local(m)
+            for i, j, l in pid:
+                p = pid[i, j, l]
+                u = ti.floor(x[p] * N).cast(ti.i32)
+                u0 = ti.assume_in_range(u[0], i, 0, 1)
+                u1 = ti.assume_in_range(u[1], j, 0, 1)
+                for offset in ti.static(ti.grouped(ti.ndrange(3, 3))):
+                    m[ti.Vector([u0, u1]) + offset] += 1.0
+
+        seed()
+        insert()
+        return ti.benchmark(p2g, repeat=10)
+
+    return benchmark()
+
+
+# 5-point stencil over 16x16 blocks, gathering from global memory vs. from a
+# per-thread 18x18 staging buffer
+def benchmark_laplacian_2d_global():
+    return _laplacian_2d_with(False)
+
+
+def benchmark_laplacian_2d_block_local():
+    return _laplacian_2d_with(True)
+
+
+# Particle-to-grid scatter with global atomics vs. into a per-thread buffer
+# written back once per block
+def benchmark_p2g_global():
+    return _p2g_with(False)
+
+
+def benchmark_p2g_block_local():
+    return _p2g_with(True)
@@ -0,0 +1,30 @@
+import taichi as ti
+import time
+
+
+# Compilation time of 100 small kernels that use the runtime for random
+# numbers and struct accesses.
+def benchmark_compile_100_kernels():
+    # The kernel cache would hide the compilation cost
+    @ti.archs_with([ti.cpu], kernel_cache=False)
+    def benchmark():
+        n = 1024
+        x = ti.field(dtype=ti.f32, shape=n)
+        y = ti.field(dtype=ti.f32, shape=n)
+
+        def make_kernel(k):
+            @ti.kernel
+            def saxpy():
+                for i in x:
+                    y[i] = y[i] * k + ti.sqrt(x[i]) + ti.random()
+
+            return saxpy
+
+        kernels = [make_kernel(k) for k in range(100)]
+        t = time.time()
+        for kernel in kernels:
+            kernel()
+        ti.sync()
+        ti.stat_write('compilation_time', time.time() - t)
+
+    return benchmark()
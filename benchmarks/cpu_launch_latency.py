@@ -0,0 +1,23 @@
+import taichi as ti
+
+
+def _empty_range_for_with(**kwargs):
+    @ti.archs_with([ti.cpu], **kwargs)
+    def benchmark():
+        @ti.kernel
+        def empty():
+            for i in range(1024):
+                pass
+
+        return ti.benchmark(empty, repeat=10000)
+
+    return benchmark()
+
+
+# Launch overhead of a trivial parallel range-for on the CPU thread pool.
+def benchmark_empty_range_for_default_pool():
+    return _empty_range_for_with()
+
+
+def benchmark_empty_range_for_work_stealing_pool():
+    return _empty_range_for_with(cpu_work_stealing=True)
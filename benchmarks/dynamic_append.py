@@ -0,0 +1,33 @@
+import taichi as ti
+
+
+# Appends 10^8 elements to a single dynamic node. Each append locates its
+# chunk through the chunk directory in O(1) time.
+def _append_with(chunk_size):
+    @ti.archs_with([ti.cpu, ti.cuda])
+    def benchmark():
+        n = 10**8
+        x = ti.field(dtype=ti.i32)
+        block = ti.root.dynamic(ti.i, 2**27, chunk_size)
+        block.place(x)
+
+        @ti.kernel
+        def append():
+            for i in range(n):
+                ti.append(block, [], i)
+
+        def task():
+            append()
+            block.deactivate_all()
+
+        return ti.benchmark(task, repeat=3)
+
+    return benchmark()
+
+
+def benchmark_append_chunk_1024():
+    return _append_with(1024)
+
+
+def benchmark_append_chunk_65536():
+    return _append_with(65536)
@@ -40,3 +40,27 @@ def benchmark_nested_struct_fill_and_clear():
         clear()
 
     return ti.benchmark(task, repeat=30)
+
+
+@ti.archs_support_sparse
+def benchmark_deactivate_pointer_cells():
+    a = ti.field(dtype=ti.f32)
+    N = 10**7
+
+    ti.root.pointer(ti.i, N).place(a)
+
+    @ti.kernel
+    def activate():
+        for i in range(N):
+            a[i] = 1.0
+
+    @ti.kernel
+    def deactivate():
+        for i in a.parent():
+            ti.deactivate(a.parent(), i)
+
+    def task():
+        activate()
+        deactivate()
+
+    return ti.benchmark(task, repeat=5)
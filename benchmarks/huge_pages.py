@@ -0,0 +1,32 @@
+import taichi as ti
+
+N = 1024**3 // 4  # 1 GB per field
+
+
+# Strided accesses over large dense fields touch a new 4 KB page almost every
+# iteration. 2 MB pages cut the number of TLB misses.
+def _gather_with(**kwargs):
+    @ti.archs_with([ti.cpu], **kwargs)
+    def benchmark():
+        x = ti.field(dtype=ti.f32, shape=N)
+        y = ti.field(dtype=ti.f32, shape=N)
+
+        M = 4096
+
+        @ti.kernel
+        def gather():
+            for i in y:
+                # Read |x| as a transposed M x (N / M) matrix
+                y[i] = x[i % M * (N // M) + i // M]
+
+        return ti.benchmark(gather, repeat=10)
+
+    return benchmark()
+
+
+def benchmark_gather_4k_pages():
+    return _gather_with(cpu_huge_pages=False)
+
+
+def benchmark_gather_huge_pages():
+    return _gather_with(cpu_huge_pages=True)
@@ -0,0 +1,64 @@
+import taichi as ti
+
+N = 1024**3 // 4  # 1 GB per buffer
+
+
+# Same kernels as memory_bound.py, under the CPU NUMA modes.
+def _saxpy_with(**kwargs):
+    @ti.archs_with([ti.cpu], **kwargs)
+    def benchmark():
+        x = ti.field(dtype=ti.f32, shape=N)
+        y = ti.field(dtype=ti.f32, shape=N)
+        z = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def task():
+            for i in x:
+                a = 123
+                z[i] = a * x[i] + y[i]
+
+        return ti.benchmark(task, repeat=10)
+
+    return benchmark()
+
+
+def _memcpy_with(**kwargs):
+    @ti.archs_with([ti.cpu], **kwargs)
+    def benchmark():
+        a = ti.field(dtype=ti.f32, shape=N)
+        b = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def memcpy():
+            for i in a:
+                a[i] = b[i]
+
+        return ti.benchmark(memcpy, repeat=10)
+
+    return benchmark()
+
+
+# 12 B/it
+def benchmark_saxpy_default():
+    return _saxpy_with()
+
+
+def benchmark_saxpy_numa_first_touch():
+    return _saxpy_with(cpu_numa=True)
+
+
+def benchmark_saxpy_numa_interleave():
+    return _saxpy_with(cpu_numa=True, cpu_numa_memory_policy='interleave')
+
+
+# 8 B/it
+def benchmark_memcpy_default():
+    return _memcpy_with()
+
+
+def benchmark_memcpy_numa_first_touch():
+    return _memcpy_with(cpu_numa=True)
+
+
+def benchmark_memcpy_numa_interleave():
+    return _memcpy_with(cpu_numa=True, cpu_numa_memory_policy='interleave')
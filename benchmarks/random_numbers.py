@@ -0,0 +1,68 @@
+import taichi as ti
+
+
+# Monte Carlo kernels dominated by ti.random(), with the default per-thread
+# xorshift states and with the counter-based generator.
+def _monte_carlo_pi_with(**kwargs):
+    @ti.archs_with([ti.cpu, ti.cuda], **kwargs)
+    def benchmark():
+        n = 1024 * 1024
+        hits = ti.field(dtype=ti.i32, shape=())
+
+        @ti.kernel
+        def sample():
+            for i in range(n):
+                x = ti.random()
+                y = ti.random()
+                if x * x + y * y < 1:
+                    hits[None] += 1
+
+        return ti.benchmark(sample, repeat=10)
+
+    return benchmark()
+
+
+def _path_tracing_with(**kwargs):
+    @ti.archs_with([ti.cpu, ti.cuda], **kwargs)
+    def benchmark():
+        res = 512
+        spp = 16
+        max_depth = 8
+        img = ti.field(dtype=ti.f32, shape=(res, res))
+
+        # Random walks over a diffuse surface under a sky light
+        @ti.kernel
+        def render():
+            for i, j in img:
+                radiance = 0.0
+                for _ in range(spp):
+                    throughput = 1.0
+                    for depth in range(max_depth):
+                        # Rays leaving close to the zenith reach the sky
+                        cos_theta = ti.random()
+                        phi = ti.random() * 6.2831853
+                        if cos_theta * ti.cos(phi) > 0.6:
+                            radiance += throughput
+                            break
+                        throughput *= 0.7 * cos_theta
+                img[i, j] = radiance / spp
+
+        return ti.benchmark(render, repeat=5)
+
+    return benchmark()
+
+
+def benchmark_monte_carlo_pi():
+    return _monte_carlo_pi_with()
+
+
+def benchmark_monte_carlo_pi_counter_based():
+    return _monte_carlo_pi_with(random_counter_based=True)
+
+
+def benchmark_path_tracing():
+    return _path_tracing_with()
+
+
+def benchmark_path_tracing_counter_based():
+    return _path_tracing_with(random_counter_based=True)
@@ -0,0 +1,84 @@
+import taichi as ti
+
+N = 1024 * 1024 * 16
+
+
+# Range-for bodies vectorized by LLVM (cpu_simd_width=0 or a fixed width)
+# against one scalar body call per index (cpu_simd_width=1).
+def _saxpy_with(simd_width):
+    @ti.archs_with([ti.cpu], cpu_simd_width=simd_width)
+    def benchmark():
+        x = ti.field(dtype=ti.f32, shape=N)
+        y = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def saxpy():
+            for i in x:
+                y[i] = 2.0 * x[i] + y[i]
+
+        return ti.benchmark(saxpy, repeat=10)
+
+    return benchmark()
+
+
+def _gather_with(simd_width):
+    @ti.archs_with([ti.cpu], cpu_simd_width=simd_width)
+    def benchmark():
+        x = ti.field(dtype=ti.f32, shape=N)
+        y = ti.field(dtype=ti.f32, shape=N)
+        idx = ti.field(dtype=ti.i32, shape=N)
+
+        @ti.kernel
+        def init():
+            for i in idx:
+                idx[i] = (i * 97) % N
+
+        @ti.kernel
+        def gather():
+            for i in y:
+                y[i] = x[idx[i]] * 0.5
+
+        init()
+        return ti.benchmark(gather, repeat=10)
+
+    return benchmark()
+
+
+def _polynomial_with(simd_width):
+    @ti.archs_with([ti.cpu], cpu_simd_width=simd_width)
+    def benchmark():
+        x = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def polynomial():
+            for i in x:
+                t = i * 1e-6
+                x[i] = ((t * 0.3 + 0.2) * t + 0.1) * t + ti.sqrt(t)
+
+        return ti.benchmark(polynomial, repeat=10)
+
+    return benchmark()
+
+
+def benchmark_saxpy_scalar():
+    return _saxpy_with(1)
+
+
+def benchmark_saxpy_simd():
+    return _saxpy_with(0)
+
+
+def benchmark_gather_scalar():
+    return _gather_with(1)
+
+
+def benchmark_gather_simd():
+    return _gather_with(0)
+
+
+def benchmark_polynomial_scalar():
+    return _polynomial_with(1)
+
+
+def benchmark_polynomial_simd():
+    return _polynomial_with(0)
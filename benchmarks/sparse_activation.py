@@ -0,0 +1,53 @@
+import taichi as ti
+
+
+def _activate_pointer_with(**kwargs):
+    @ti.archs_with([ti.cpu], **kwargs)
+    def benchmark():
+        a = ti.field(dtype=ti.f32)
+        N = 1024
+
+        block = ti.root.pointer(ti.ij, [N, N])
+        block.dense(ti.ij, [4, 4]).place(a)
+
+        @ti.kernel
+        def activate():
+            for i, j in ti.ndrange(N, N):
+                ti.activate(block, [i, j])
+
+        def task():
+            activate()
+            block.deactivate_all()
+
+        return ti.benchmark(task, repeat=10)
+
+    return benchmark()
+
+
+# Node activation throughput, with and without per-thread allocation
+# magazines, as the number of CPU threads grows.
+def benchmark_activate_pointer_1_thread():
+    return _activate_pointer_with(cpu_max_num_threads=1)
+
+
+def benchmark_activate_pointer_1_thread_magazines():
+    return _activate_pointer_with(cpu_max_num_threads=1,
+                                  cpu_alloc_magazines=True)
+
+
+def benchmark_activate_pointer_8_threads():
+    return _activate_pointer_with(cpu_max_num_threads=8)
+
+
+def benchmark_activate_pointer_8_threads_magazines():
+    return _activate_pointer_with(cpu_max_num_threads=8,
+                                  cpu_alloc_magazines=True)
+
+
+def benchmark_activate_pointer_64_threads():
+    return _activate_pointer_with(cpu_max_num_threads=64)
+
+
+def benchmark_activate_pointer_64_threads_magazines():
+    return _activate_pointer_with(cpu_max_num_threads=64,
+                                  cpu_alloc_magazines=True)
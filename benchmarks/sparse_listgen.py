@@ -0,0 +1,46 @@
+import taichi as ti
+
+
+def _listgen_with_threads(num_threads):
+    @ti.archs_with([ti.cpu], cpu_max_num_threads=num_threads)
+    def benchmark():
+        a = ti.field(dtype=ti.f32)
+        N = 256
+
+        ti.root.pointer(ti.ij, [N, N]).pointer(ti.ij,
+                                               [8, 8]).dense(ti.ij,
+                                                             [4, 4]).place(a)
+
+        @ti.kernel
+        def fill():
+            for i, j in ti.ndrange(N * 32, N * 32):
+                if (i + j) % 3 == 0:
+                    a[i, j] = 1.0
+
+        @ti.kernel
+        def traverse():
+            for i, j in a:
+                a[i, j] += 1.0
+
+        fill()
+        return ti.benchmark(traverse, repeat=30)
+
+    return benchmark()
+
+
+# Listgen runs on a single CPU thread unless the parent elements are split
+# across the thread pool. Compare the scaling with respect to threads.
+def benchmark_listgen_1_thread():
+    return _listgen_with_threads(1)
+
+
+def benchmark_listgen_4_threads():
+    return _listgen_with_threads(4)
+
+
+def benchmark_listgen_16_threads():
+    return _listgen_with_threads(16)
+
+
+def benchmark_listgen_64_threads():
+    return _listgen_with_threads(64)
@@ -0,0 +1,41 @@
+import taichi as ti
+
+
+def _laplacian_3d_with(morton):
+    @ti.archs_with([ti.cpu, ti.cuda])
+    def benchmark():
+        x = ti.field(dtype=ti.f32)
+        y = ti.field(dtype=ti.f32)
+        N = 256
+        block_size = 8
+
+        block = ti.root.dense(ti.ijk, N // block_size)
+        block.dense(ti.ijk, block_size, morton=morton).place(x)
+        block.dense(ti.ijk, block_size, morton=morton).place(y)
+
+        @ti.kernel
+        def fill():
+            for i, j, k in x:
+                x[i, j, k] = (i * 7 + j * 3 + k) % 11
+
+        @ti.kernel
+        def laplacian():
+            for i, j, k in y:
+                if 0 < i < N - 1 and 0 < j < N - 1 and 0 < k < N - 1:
+                    y[i, j, k] = 6 * x[i, j, k] - x[i - 1, j, k] - x[
+                        i + 1, j, k] - x[i, j - 1, k] - x[i, j + 1, k] - x[
+                            i, j, k - 1] - x[i, j, k + 1]
+
+        fill()
+        return ti.benchmark(laplacian, repeat=10)
+
+    return benchmark()
+
+
+# 7-point stencil over 8x8x8 blocks: row-major vs. Z-order cells
+def benchmark_laplacian_3d_row_major():
+    return _laplacian_3d_with(False)
+
+
+def benchmark_laplacian_3d_morton():
+    return _laplacian_3d_with(True)
@@ -205,6 +205,45 @@ class Expr(TaichiOperations):
     def from_torch(self, arr):
         self.from_numpy(arr.contiguous())
 
+    @python_scope
+    def gather(self, indices):
+        '''Reads many cells in one kernel launch.
+
+        Args:
+            indices: The cells, of shape ``(n, len(self.shape))``.
+
+        Returns:
+            A numpy array of shape ``(n, )`` with the values of the cells.
+        '''
+        from .meta import tensor_gather
+        import numpy as np
+        assert len(self.shape) > 0, 'Use x[None] for 0-D fields'
+        indices = to_index_array(indices, len(self.shape))
+        arr = np.zeros(shape=indices.shape[0],
+                       dtype=to_numpy_type(self.dtype))
+        tensor_gather(self, indices, arr)
+        import taichi as ti
+        ti.sync()
+        return arr
+
+    @python_scope
+    def scatter(self, indices, values):
+        '''Writes many cells in one kernel launch.
+
+        Args:
+            indices: The cells, of shape ``(n, len(self.shape))``.
+            values: The values to write, of shape ``(n, )``.
+        '''
+        from .meta import tensor_scatter
+        import numpy as np
+        assert len(self.shape) > 0, 'Use x[None] for 0-D fields'
+        indices = to_index_array(indices, len(self.shape))
+        values = np.ascontiguousarray(values, dtype=to_numpy_type(self.dtype))
+        assert values.shape == indices.shape[:1]
+        tensor_scatter(self, indices, values)
+        import taichi as ti
+        ti.sync()
+
     @python_scope
     def copy_from(self, other):
         assert isinstance(other, Expr)
@@ -3,7 +3,7 @@ from . import impl
 import copy
 import numbers
 import numpy as np
-from .util import taichi_scope, python_scope, deprecated, to_numpy_type, to_pytorch_type, in_python_scope, is_taichi_class, warning
+from .util import taichi_scope, python_scope, deprecated, to_numpy_type, to_pytorch_type, to_index_array, in_python_scope, is_taichi_class, warning
 from .common_ops import TaichiOperations
 from .exception import TaichiSyntaxError
 from collections.abc import Iterable
@@ -725,6 +725,52 @@ class Matrix(TaichiOperations):
     def from_torch(self, torch_tensor):
         return self.from_numpy(torch_tensor.contiguous())
 
+    @python_scope
+    def gather(self, indices, keep_dims=False):
+        '''Reads many cells in one kernel launch.
+
+        Args:
+            indices: The cells, of shape ``(n, len(self.shape))``.
+            keep_dims: As in ``to_numpy``.
+
+        Returns:
+            A numpy array of shape ``(n, self.n)`` for vectors, or
+            ``(n, self.n, self.m)`` for matrices.
+        '''
+        assert len(self.shape) > 0, 'Use x[None] for 0-D fields'
+        indices = to_index_array(indices, len(self.shape))
+        as_vector = self.m == 1 and not keep_dims
+        shape_ext = (self.n, ) if as_vector else (self.n, self.m)
+        ret = np.zeros((indices.shape[0], ) + shape_ext,
+                       dtype=to_numpy_type(self.dtype))
+        from .meta import matrix_gather
+        matrix_gather(self, indices, ret, as_vector)
+        import taichi as ti
+        ti.sync()
+        return ret
+
+    @python_scope
+    def scatter(self, indices, values):
+        '''Writes many cells in one kernel launch.
+
+        Args:
+            indices: The cells, of shape ``(n, len(self.shape))``.
+            values: The values to write, of shape ``(n, self.n)`` for
+                vectors, or ``(n, self.n, self.m)``.
+        '''
+        assert len(self.shape) > 0, 'Use x[None] for 0-D fields'
+        indices = to_index_array(indices, len(self.shape))
+        values = np.ascontiguousarray(values, dtype=to_numpy_type(self.dtype))
+        as_vector = values.ndim == 2
+        if as_vector:
+            assert self.m == 1, "This matrix is not a vector"
+        shape_ext = (self.n, ) if as_vector else (self.n, self.m)
+        assert values.shape == (indices.shape[0], ) + shape_ext
+        from .meta import matrix_scatter
+        matrix_scatter(self, indices, values, as_vector)
+        import taichi as ti
+        ti.sync()
+
     @python_scope
     def copy_from(self, other):
         assert isinstance(other, Matrix)
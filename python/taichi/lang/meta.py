@@ -95,6 +95,55 @@ def ext_arr_to_matrix(arr: ti.ext_arr(), mat: ti.template(),
                     mat[I][p, q] = arr[I, p, q]
 
 
+@ti.func
+def ext_arr_to_index(indices: ti.template(), i, dim: ti.template()):
+    I = ti.Vector.zero(ti.i32, dim)
+    for j in ti.static(range(dim)):
+        I[j] = indices[i, j]
+    return I
+
+
+# Batched accessors: |indices| is an (n, dim) array of cells
+@ti.kernel
+def tensor_gather(tensor: ti.template(), indices: ti.ext_arr(),
+                  arr: ti.ext_arr()):
+    for i in range(indices.shape[0]):
+        arr[i] = tensor[ext_arr_to_index(indices, i, len(tensor.shape))]
+
+
+@ti.kernel
+def tensor_scatter(tensor: ti.template(), indices: ti.ext_arr(),
+                   arr: ti.ext_arr()):
+    for i in range(indices.shape[0]):
+        tensor[ext_arr_to_index(indices, i, len(tensor.shape))] = arr[i]
+
+
+@ti.kernel
+def matrix_gather(mat: ti.template(), indices: ti.ext_arr(),
+                  arr: ti.ext_arr(), as_vector: ti.template()):
+    for i in range(indices.shape[0]):
+        I = ext_arr_to_index(indices, i, len(mat.shape))
+        for p in ti.static(range(mat.n)):
+            for q in ti.static(range(mat.m)):
+                if ti.static(as_vector):
+                    arr[i, p] = mat[I][p]
+                else:
+                    arr[i, p, q] = mat[I][p, q]
+
+
+@ti.kernel
+def matrix_scatter(mat: ti.template(), indices: ti.ext_arr(),
+                   arr: ti.ext_arr(), as_vector: ti.template()):
+    for i in range(indices.shape[0]):
+        I = ext_arr_to_index(indices, i, len(mat.shape))
+        for p in ti.static(range(mat.n)):
+            for q in ti.static(range(mat.m)):
+                if ti.static(as_vector):
+                    mat[I][p] = arr[i, p]
+                else:
+                    mat[I][p, q] = arr[i, p, q]
+
+
 @ti.kernel
 def clear_gradients(vars: ti.template()):
     for I in ti.grouped(ti.Expr(vars[0])):
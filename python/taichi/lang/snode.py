@@ -7,20 +7,25 @@ class SNode:
     def __init__(self, ptr):
         self.ptr = ptr
 
-    def dense(self, indices, dimensions):
+    def dense(self, indices, dimensions, morton=False):
         if isinstance(dimensions, int):
             dimensions = [dimensions] * len(indices)
-        return SNode(self.ptr.dense(indices, dimensions))
+        ptr = self.ptr.dense(indices, dimensions)
+        if morton:
+            ptr.morton(True)
+        return SNode(ptr)
 
     def pointer(self, indices, dimensions):
         if isinstance(dimensions, int):
             dimensions = [dimensions] * len(indices)
         return SNode(self.ptr.pointer(indices, dimensions))
 
-    def hash(self, indices, dimensions):
+    def hash(self, indices, dimensions, capacity=None):
         if isinstance(dimensions, int):
             dimensions = [dimensions] * len(indices)
-        return SNode(self.ptr.hash(indices, dimensions))
+        if capacity is None:
+            capacity = 0
+        return SNode(self.ptr.hash(indices, dimensions, capacity))
 
     def dynamic(self, index, dimension, chunk_size=None):
         assert len(index) == 1
@@ -156,7 +161,10 @@ class SNode:
         for c in ch:
             c.deactivate_all()
         import taichi as ti
-        if self.ptr.type == ti.core.SNodeType.pointer or self.ptr.type == ti.core.SNodeType.bitmasked:
+        if self.ptr.type in [
+                ti.core.SNodeType.pointer, ti.core.SNodeType.bitmasked,
+                ti.core.SNodeType.hash
+        ]:
             from .meta import snode_deactivate
             snode_deactivate(self)
         if self.ptr.type == ti.core.SNodeType.dynamic:
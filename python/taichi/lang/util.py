@@ -181,6 +181,22 @@ def cook_dtype(dtype):
         raise ValueError(f'Invalid data type {dtype}')
 
 
+def to_index_array(indices, dim):
+    '''Converts the cells of a batched access to an (n, dim) i32 array.
+
+    Args:
+        indices: Anything ``np.array`` accepts, of shape ``(n, dim)``, or of
+            shape ``(n, )`` for 1-D fields.
+        dim: The dimensionality of the field.
+    '''
+    indices = np.ascontiguousarray(indices, dtype=np.int32)
+    if dim == 1 and indices.ndim == 1:
+        indices = indices.reshape(-1, 1)
+    assert indices.ndim == 2 and indices.shape[1] == dim, \
+        f'Expected indices of shape (n, {dim}), got {indices.shape}'
+    return indices
+
+
 def in_taichi_scope():
     from . import impl
     return impl.inside_kernel()
@@ -13,6 +13,7 @@ void CCLayoutGen::generate_children(SNode *snode) {
 }
 
 void CCLayoutGen::generate_types(SNode *snode) {
+  TI_ERROR_IF(snode->_morton, "Morton layout not supported on C backend");
   // suffix is for the array size
   auto node_name = snode->node_type_name;
   auto struct_name = "Ti_" + snode->get_node_type_name_hinted();
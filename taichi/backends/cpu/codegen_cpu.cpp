@@ -8,6 +8,8 @@
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/util/statistics.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/program/async_engine.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -42,11 +44,22 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
       auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
       loop_vars_llvm[stmt].push_back(loop_var);
       builder->CreateStore(get_arg(2), loop_var);
+      init_rand_stream(get_arg(2));
       stmt->body->accept(this);
 
       body = guard.body;
     }
 
+    llvm::Value *block_body;
+    if (stmt->reversed || prog->config.cpu_simd_width == 1) {
+      // Parameter 8 is |block_body|
+      auto runtime_func = get_runtime_function("cpu_parallel_range_for");
+      block_body = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+          runtime_func->getFunctionType()->getParamType(8)));
+    } else {
+      block_body = create_range_for_block_body(body);
+    }
+
     llvm::Value *epilogue = create_xlogue(stmt->tls_epilogue);
 
     auto [begin, end] = get_range_for_bounds(stmt);
@@ -54,7 +67,66 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
         "cpu_parallel_range_for",
         {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin, end,
          tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
-         tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size)});
+         tls_prologue, body, block_body, epilogue,
+         tlctx->get_constant(stmt->tls_size)});
+  }
+
+  // Creates a function running |body| on the indices in [begin, end). Once
+  // |body| is inlined into the loop, LLVM vectorizes the loop (with a
+  // scalar remainder, and gathers/scatters for non-contiguous accesses),
+  // which it cannot do across the call per index made by the runtime.
+  llvm::Function *create_range_for_block_body(llvm::Function *body) {
+    body->addFnAttr(llvm::Attribute::AlwaysInline);
+    auto guard = get_function_creation_guard(
+        {llvm::PointerType::get(get_runtime_type("Context"), 0),
+         llvm::Type::getInt8PtrTy(*llvm_context), tlctx->get_data_type<int>(),
+         tlctx->get_data_type<int>()});
+    auto loop_test =
+        llvm::BasicBlock::Create(*llvm_context, "block_loop_test", func);
+    auto loop_body =
+        llvm::BasicBlock::Create(*llvm_context, "block_loop_body", func);
+    auto after_loop =
+        llvm::BasicBlock::Create(*llvm_context, "block_after_loop", func);
+
+    auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+    builder->CreateStore(get_arg(2), loop_var);
+    builder->CreateBr(loop_test);
+
+    builder->SetInsertPoint(loop_test);
+    llvm::Value *i = builder->CreateLoad(loop_var);
+    builder->CreateCondBr(builder->CreateICmpSLT(i, get_arg(3)), loop_body,
+                          after_loop);
+
+    builder->SetInsertPoint(loop_body);
+    create_call(body, {get_arg(0), get_arg(1), i});
+    create_increment(loop_var, tlctx->get_constant(1));
+    auto back_edge = builder->CreateBr(loop_test);
+    back_edge->setMetadata(llvm::LLVMContext::MD_loop,
+                           get_vectorize_loop_metadata());
+
+    builder->SetInsertPoint(after_loop);
+    return guard.body;
+  }
+
+  // Asks LLVM to vectorize a loop, with a vector width of cpu_simd_width if
+  // set
+  llvm::MDNode *get_vectorize_loop_metadata() {
+    using namespace llvm;
+    std::vector<Metadata *> ops = {nullptr};
+    ops.push_back(MDNode::get(
+        *llvm_context,
+        {MDString::get(*llvm_context, "llvm.loop.vectorize.enable"),
+         ConstantAsMetadata::get(builder->getTrue())}));
+    auto simd_width = prog->config.cpu_simd_width;
+    if (simd_width > 1) {
+      ops.push_back(MDNode::get(
+          *llvm_context,
+          {MDString::get(*llvm_context, "llvm.loop.vectorize.width"),
+           ConstantAsMetadata::get(builder->getInt32(simd_width))}));
+    }
+    auto loop_id = MDNode::getDistinct(*llvm_context, ops);
+    loop_id->replaceOperandWith(0, loop_id);
+    return loop_id;
   }
 
   void visit(OffloadedStmt *stmt) override {
@@ -72,10 +144,12 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
       stmt->body->accept(this);
     } else if (stmt->task_type == Type::range_for) {
       create_offload_range_for(stmt);
+      current_task->autotune_kind = CPUAutotuner::TaskKind::range_for;
     } else if (stmt->task_type == Type::struct_for) {
       stmt->block_dim = std::min(stmt->snode->parent->max_num_elements(),
                                  (int64)stmt->block_dim);
       create_offload_struct_for(stmt);
+      current_task->autotune_kind = CPUAutotuner::TaskKind::struct_for;
     } else if (stmt->task_type == Type::listgen) {
       emit_list_gen(stmt);
     } else if (stmt->task_type == Type::gc) {
@@ -86,6 +160,15 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
     if (prog->config.kernel_profiler && arch_is_cpu(prog->config.arch)) {
       call(builder.get(), "LLVMRuntime_profiler_stop", {get_runtime()});
     }
+    // Serial loops must stay serial, e.g. for demoted atomics
+    if (stmt->num_cpu_threads <= 1)
+      current_task->autotune_kind.reset();
+    if (current_task->autotune_kind) {
+      current_task->autotune_key =
+          CPUAutotuner::get_task_key(kernel->name, task_counter - 1,
+                                     *current_task->autotune_kind, stmt);
+    }
+    current_task->num_cpu_threads = stmt->num_cpu_threads;
     finalize_offloaded_task_function();
     current_task->end();
     current_task = nullptr;
@@ -122,7 +205,58 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
 
 FunctionType CodeGenCPU::codegen() {
   TI_AUTO_PROF
-  return CodeGenLLVMCPU(kernel, ir).gen();
+  auto block = dynamic_cast<Block *>(ir);
+  if (prog->compilation_workers && block && block->statements.size() > 1)
+    return codegen_in_parallel(block);
+  CodeGenLLVMCPU gen(kernel, ir);
+  gen.fast_compile = fast_compile;
+  return gen.gen();
+}
+
+FunctionType CodeGenCPU::codegen_in_parallel(Block *block) {
+  TI_AUTO_PROF
+  // Each offloaded task gets its own module, generated and compiled (with
+  // the LLVM context of the worker thread) independently. Tasks only
+  // communicate through global temporaries, so they need no linking other
+  // than with the runtime.
+  auto num_tasks = block->statements.size();
+  std::vector<std::vector<OffloadedTask>> tasks(num_tasks);
+  std::vector<std::exception_ptr> errors(num_tasks);
+  int num_rand_call_sites = 0;
+  for (std::size_t i = 0; i < num_tasks; i++) {
+    auto offloaded = block->statements[i]->as<OffloadedStmt>();
+    // Keep the counter-based random streams of the serial path
+    auto first_rand_call_site = num_rand_call_sites;
+    num_rand_call_sites +=
+        irpass::analysis::gather_statements(
+            offloaded, [](Stmt *stmt) { return stmt->is<RandStmt>(); })
+            .size();
+    auto compile_task = [&, i, offloaded, first_rand_call_site]() {
+      try {
+        CodeGenLLVMCPU gen(kernel, offloaded);
+        // Name the task as the serial path does
+        gen.task_counter = (int)i;
+        gen.num_rand_call_sites = first_rand_call_site;
+        gen.fast_compile = fast_compile;
+        gen.emit_to_module();
+        gen.compile_module_to_tasks();
+        tasks[i] = gen.offloaded_tasks;
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    };
+    prog->compilation_workers->enqueue(compile_task);
+  }
+  prog->compilation_workers->flush();
+  for (auto &error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+  std::vector<OffloadedTask> all_tasks;
+  for (auto &t : tasks)
+    all_tasks.insert(all_tasks.end(), t.begin(), t.end());
+  return CodeGenLLVM::create_launcher(prog, kernel->name + "_kernel",
+                                      all_tasks);
 }
 
 TLANG_NAMESPACE_END
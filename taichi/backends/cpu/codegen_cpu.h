@@ -12,6 +12,11 @@ class CodeGenCPU : public KernelCodeGen {
   }
 
   virtual FunctionType codegen() override;
+
+ private:
+  // Generates and compiles the offloaded tasks in |block| on
+  // Program::compilation_workers.
+  FunctionType codegen_in_parallel(Block *block);
 };
 
 TLANG_NAMESPACE_END
@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
@@ -22,20 +23,27 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
 
 #include "taichi/lang_util.h"
 #include "taichi/program/program.h"
 #include "taichi/jit/jit_session.h"
+#include "taichi/jit/kernel_cache.h"
 #include "taichi/util/file_sequence_writer.h"
 
 TLANG_NAMESPACE_BEGIN
@@ -43,6 +51,75 @@ TLANG_NAMESPACE_BEGIN
 using namespace llvm;
 using namespace llvm::orc;
 
+// Creates the subtarget info of |cpu|, or returns nullptr if the target does
+// not know |cpu|.
+std::unique_ptr<MCSubtargetInfo> create_subtarget_info(const Triple &triple,
+                                                       const std::string &cpu) {
+  std::string err_str;
+  auto target = TargetRegistry::lookupTarget(triple.str(), err_str);
+  if (!target)
+    return nullptr;
+  std::unique_ptr<MCSubtargetInfo> subtarget_info(
+      target->createMCSubtargetInfo(triple.str(), cpu, ""));
+  if (!subtarget_info || !subtarget_info->isCPUStringValid(cpu))
+    return nullptr;
+  return subtarget_info;
+}
+
+// Returns whether the host CPU can run code compiled for |cpu| with the
+// comma-separated |features| ("+avx2,-fma") applied on top.
+bool host_can_run(const Triple &triple,
+                  const std::string &cpu,
+                  const std::string &features) {
+  auto subtarget_info = create_subtarget_info(triple, cpu);
+  StringMap<bool> host_features;
+  if (!subtarget_info || !llvm::sys::getHostCPUFeatures(host_features))
+    return false;
+  SmallVector<StringRef, 8> extra_features;
+  StringRef(features).split(extra_features, ',', -1, false);
+  for (auto feature : extra_features) {
+    auto flag = feature.trim().str();
+    // Like SubtargetFeatures::AddFeature, a bare name enables the feature
+    if (!SubtargetFeatures::hasFlag(flag))
+      flag = "+" + flag;
+    subtarget_info->ApplyFeatureFlag(flag);
+  }
+  // Every feature the host lacks must be off on |cpu|
+  for (auto &feature : host_features) {
+    if (!feature.second &&
+        subtarget_info->checkFeatures("+" + feature.first().str()))
+      return false;
+  }
+  return true;
+}
+
+// Applies CompileConfig::cpu_target and cpu_features to |jtmb|. Called once
+// per JIT session, so an unusable target is reported only once.
+void set_target_cpu(JITTargetMachineBuilder &jtmb) {
+  if (!current_program)
+    return;
+  auto &config = current_program->config;
+  if (config.cpu_target != "native") {
+    if (!create_subtarget_info(jtmb.getTargetTriple(), config.cpu_target) ||
+        !host_can_run(jtmb.getTargetTriple(), config.cpu_target,
+                      config.cpu_features)) {
+      // Erroring out here would leave the Program half-constructed
+      TI_WARN(
+          "CPU target \"{}\" (features \"{}\") is unknown or cannot run on "
+          "the host CPU, compiling for the host CPU instead",
+          config.cpu_target, config.cpu_features);
+      return;
+    }
+    jtmb.setCPU(config.cpu_target);
+    // Only use the features of the target, not those of the host
+    jtmb.getFeatures() = SubtargetFeatures();
+  }
+  SmallVector<StringRef, 8> features;
+  StringRef(config.cpu_features).split(features, ',', -1, false);
+  for (auto feature : features)
+    jtmb.getFeatures().AddFeature(feature.trim());
+}
+
 std::pair<JITTargetMachineBuilder, llvm::DataLayout> get_host_target_info() {
 #if defined(TI_PLATFORM_OSX) and defined(TI_ARCH_ARM)
   // JITTargetMachineBuilder::detectHost() doesn't seem to work properly on
@@ -55,6 +132,8 @@ std::pair<JITTargetMachineBuilder, llvm::DataLayout> get_host_target_info() {
   if (!expected_jtmb)
     TI_ERROR("LLVM TargetMachineBuilder has failed.");
   auto jtmb = *expected_jtmb;
+  jtmb.setCPU(llvm::sys::getHostCPUName().str());
+  set_target_cpu(jtmb);
   auto expected_data_layout = jtmb.getDefaultDataLayoutForTarget();
   if (!expected_data_layout) {
     TI_ERROR("LLVM TargetMachineBuilder has failed when getting data layout.");
@@ -87,11 +166,12 @@ class JITSessionCPU : public JITSession {
  private:
   ExecutionSession ES;
   RTDyldObjectLinkingLayer object_layer;
-  IRCompileLayer compile_layer;
+  JITTargetMachineBuilder JTMB;
   DataLayout DL;
   MangleAndInterner Mangle;
   std::mutex mut;
   std::vector<llvm::orc::JITDylib *> all_libs;
+  std::unordered_map<std::string, bool> host_supported_cpus;
   int module_counter;
   SectionMemoryManager *memory_manager;
 
@@ -103,9 +183,7 @@ class JITSessionCPU : public JITSession {
                        memory_manager = smgr.get();
                        return smgr;
                      }),
-        compile_layer(ES,
-                      object_layer,
-                      std::make_unique<ConcurrentIRCompiler>(JTMB)),
+        JTMB(JTMB),
         DL(DL),
         Mangle(ES, this->DL),
         module_counter(0),
@@ -128,18 +206,38 @@ class JITSessionCPU : public JITSession {
 
   JITModule *add_module(std::unique_ptr<llvm::Module> M, int max_reg) override {
     TI_ASSERT(max_reg == 0);  // No need to specify max_reg on CPUs
+    return add_module(std::move(M), /*fast=*/false);
+  }
+
+  JITModule *add_module_fast(std::unique_ptr<llvm::Module> M) override {
+    return add_module(std::move(M), /*fast=*/true);
+  }
+
+  JITModule *add_module(std::unique_ptr<llvm::Module> M, bool fast) {
     TI_ASSERT(M);
-    global_optimize_module_cpu(M);
+    // Modules are compiled to objects in the calling thread, outside of the
+    // lock, so that modules added by several threads compile concurrently
+    // and the objects can be stored in the kernel cache.
+    auto kernel_cache = get_current_program().kernel_cache.get();
+    std::unique_ptr<MemoryBuffer> object;
+    std::string key;
+    if (kernel_cache) {
+      key = get_cache_key(*M, fast);
+      if (auto data = kernel_cache->load(key))
+        object = MemoryBuffer::getMemBufferCopy(*data, key);
+    }
+    if (!object) {
+      global_optimize_module_cpu(M, fast);
+      object = compile_to_object(*M, fast);
+      if (kernel_cache)
+        kernel_cache->store(key, object->getBuffer().str());
+    }
     std::lock_guard<std::mutex> _(mut);
     auto &dylib = ES.createJITDylib(fmt::format("{}", module_counter));
     dylib.addGenerator(
         cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
             DL.getGlobalPrefix())));
-    auto *thread_safe_context = get_current_program()
-                                    .get_llvm_context(host_arch())
-                                    ->get_this_thread_thread_safe_context();
-    cantFail(compile_layer.add(dylib, llvm::orc::ThreadSafeModule(
-                                          std::move(M), *thread_safe_context)));
+    cantFail(object_layer.add(dylib, std::move(object)));
     all_libs.push_back(&dylib);
     auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
     auto new_module_raw_ptr = new_module.get();
@@ -148,6 +246,18 @@ class JITSessionCPU : public JITSession {
     return new_module_raw_ptr;
   }
 
+  bool host_supports_cpu(const std::string &cpu) override {
+    std::lock_guard<std::mutex> _(mut);
+    auto it = host_supported_cpus.find(cpu);
+    if (it != host_supported_cpus.end())
+      return it->second;
+    bool supported = host_can_run(JTMB.getTargetTriple(), cpu, "");
+    TI_TRACE("Host CPU {} code for {}", supported ? "runs" : "cannot run",
+             cpu);
+    host_supported_cpus[cpu] = supported;
+    return supported;
+  }
+
   void *lookup(const std::string Name) override {
     std::lock_guard<std::mutex> _(mut);
 #ifdef __APPLE__
@@ -173,7 +283,38 @@ class JITSessionCPU : public JITSession {
   }
 
  private:
-  static void global_optimize_module_cpu(std::unique_ptr<llvm::Module> &module);
+  // With |fast|, only always_inline functions are inlined, and loops are
+  // not vectorized.
+  void global_optimize_module_cpu(std::unique_ptr<llvm::Module> &module,
+                                  bool fast);
+
+  // The key covers everything the object depends on: the unoptimized module
+  // (which contains the kernel, the runtime functions it uses and the SNode
+  // layout), the target, and the options of global_optimize_module_cpu.
+  std::string get_cache_key(llvm::Module &module, bool fast) {
+    std::string module_str;
+    llvm::raw_string_ostream os(module_str);
+    module.print(os, nullptr);
+    os.flush();
+    SHA1 hasher;
+    hasher.update(module_str);
+    hasher.update(JTMB.getTargetTriple().str());
+    hasher.update(JTMB.getCPU());
+    hasher.update(JTMB.getFeatures().getString());
+    hasher.update(get_current_program().config.fast_math ? "fast_math" : "");
+    hasher.update(fast ? "fast" : "");
+    return toHex(hasher.final(), /*LowerCase=*/true);
+  }
+
+  std::unique_ptr<MemoryBuffer> compile_to_object(llvm::Module &module,
+                                                  bool fast) {
+    TI_AUTO_PROF
+    auto jtmb = JTMB;
+    if (fast)
+      jtmb.setCodeGenOptLevel(CodeGenOpt::None);
+    auto target_machine = cantFail(jtmb.createTargetMachine());
+    return SimpleCompiler(*target_machine)(module);
+  }
 };
 
 void *JITModuleCPU::lookup_function(const std::string &name) {
@@ -181,14 +322,15 @@ void *JITModuleCPU::lookup_function(const std::string &name) {
 }
 
 void JITSessionCPU::global_optimize_module_cpu(
-    std::unique_ptr<llvm::Module> &module) {
+    std::unique_ptr<llvm::Module> &module,
+    bool fast) {
   TI_AUTO_PROF
   if (llvm::verifyModule(*module, &llvm::errs())) {
     module->print(llvm::errs(), nullptr);
     TI_ERROR("Module broken");
   }
 
-  auto triple = get_host_target_info().first.getTargetTriple();
+  auto triple = JTMB.getTargetTriple();
 
   std::string err_str;
   const llvm::Target *target =
@@ -217,10 +359,10 @@ void JITSessionCPU::global_optimize_module_cpu(
   legacy::FunctionPassManager function_pass_manager(module.get());
   legacy::PassManager module_pass_manager;
 
-  llvm::StringRef mcpu = llvm::sys::getHostCPUName();
   std::unique_ptr<TargetMachine> target_machine(target->createTargetMachine(
-      triple.str(), mcpu.str(), "", options, llvm::Reloc::PIC_,
-      llvm::CodeModel::Small, CodeGenOpt::Aggressive));
+      triple.str(), JTMB.getCPU(), JTMB.getFeatures().getString(), options,
+      llvm::Reloc::PIC_, llvm::CodeModel::Small,
+      fast ? CodeGenOpt::None : CodeGenOpt::Aggressive));
 
   TI_ERROR_UNLESS(target_machine.get(), "Could not allocate target machine!");
 
@@ -232,10 +374,15 @@ void JITSessionCPU::global_optimize_module_cpu(
       target_machine->getTargetIRAnalysis()));
 
   PassManagerBuilder b;
-  b.OptLevel = 3;
-  b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
-  b.LoopVectorize = true;
-  b.SLPVectorize = true;
+  if (fast) {
+    b.OptLevel = 1;
+    b.Inliner = createAlwaysInlinerLegacyPass();
+  } else {
+    b.OptLevel = 3;
+    b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+    b.LoopVectorize = true;
+    b.SLPVectorize = true;
+  }
 
   target_machine->adjustPassManager(b);
 
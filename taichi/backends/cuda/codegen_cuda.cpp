@@ -353,6 +353,7 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
       auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
       loop_vars_llvm[stmt].push_back(loop_var);
       builder->CreateStore(get_arg(2), loop_var);
+      init_rand_stream(get_arg(2));
       stmt->body->accept(this);
 
       body = guard.body;
@@ -388,13 +389,23 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
     }
     {
       init_offloaded_task_function(stmt, "zero_fill");
-      call("gc_parallel_2", get_context(), snode_id);
+      call("gc_parallel_2", get_context(), snode_id,
+           tlctx->get_constant((int32)gc_needs_zero_fill(stmt->snode)));
       finalize_offloaded_task_function();
       current_task->grid_dim = prog->config.saturating_grid_dim;
       current_task->block_dim = 64;
       current_task->end();
       current_task = nullptr;
     }
+    if (stmt->snode->type == SNodeType::hash) {
+      init_offloaded_task_function(stmt, "rebuild_hash_tables");
+      call("Hash_gc", emit_struct_meta(stmt->snode));
+      finalize_offloaded_task_function();
+      current_task->grid_dim = 1;
+      current_task->block_dim = 1;
+      current_task->end();
+      current_task = nullptr;
+    }
   }
 
   bool kernel_argument_by_val() const override {
@@ -463,11 +474,12 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
   void create_bls_buffer(OffloadedStmt *stmt) {
     auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
                                      stmt->bls_size);
-    bls_buffer = new GlobalVariable(
+    auto buffer = new GlobalVariable(
         *module, type, false, llvm::GlobalValue::ExternalLinkage, nullptr,
         "bls_buffer", nullptr, llvm::GlobalVariable::NotThreadLocal,
         3 /*addrspace=shared*/);
-    bls_buffer->setAlignment(llvm::MaybeAlign(8));
+    buffer->setAlignment(llvm::MaybeAlign(8));
+    bls_buffer = buffer;
   }
 
   void visit(OffloadedStmt *stmt) override {
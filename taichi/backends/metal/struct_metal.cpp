@@ -70,6 +70,8 @@ class StructCompiler {
   }
       for (const auto &sn : snodes_) {
         const auto ty = sn->type;
+        TI_ERROR_IF(sn->_morton,
+                    "Metal backend does not support Morton layout yet");
         if (ty == SNodeType::place) {
           // do nothing
         }
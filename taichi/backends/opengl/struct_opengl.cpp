@@ -32,6 +32,7 @@ void OpenglStructCompiler::collect_snodes(SNode &snode) {
 }
 
 void OpenglStructCompiler::generate_types(const SNode &snode) {
+  TI_ERROR_IF(snode._morton, "Morton layout not supported on OpenGL backend");
   const bool is_place = snode.is_place();
   const auto &node_name = snode.node_type_name;
   const auto child_name = node_name + "_ch";
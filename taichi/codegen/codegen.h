@@ -11,6 +11,9 @@ class KernelCodeGen {
   Program *prog;
   Kernel *kernel;
   IRNode *ir;
+  // Spend as little time as possible on backend optimization, e.g. for the
+  // first tier of tiered compilation
+  bool fast_compile{false};
 
  public:
   KernelCodeGen(Kernel *kernel, IRNode *ir);
@@ -23,6 +26,10 @@ class KernelCodeGen {
 
   virtual FunctionType compile();
 
+  void set_fast_compile(bool fast_compile) {
+    this->fast_compile = fast_compile;
+  }
+
   virtual FunctionType codegen() = 0;
 };
 
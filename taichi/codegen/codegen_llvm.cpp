@@ -1,5 +1,7 @@
 #include "taichi/codegen/codegen_llvm.h"
 
+#include <unordered_set>
+
 #include "taichi/ir/statements.h"
 #include "taichi/struct/struct_llvm.h"
 #include "taichi/util/file_sequence_writer.h"
@@ -27,9 +29,16 @@ void OffloadedTask::operator()(Context *context) {
   func(context);
 }
 
-void OffloadedTask::compile() {
+void OffloadedTask::compile(JITModule *module, JITModule *variant_module) {
   TI_ASSERT(!func);
-  auto kernel_symbol = codegen->tlctx->lookup_function_pointer(name);
+  void *kernel_symbol;
+  if (!variant_name.empty() &&
+      codegen->tlctx->jit->host_supports_cpu(
+          codegen->prog->config.cpu_multiversioning_target)) {
+    kernel_symbol = variant_module->lookup_function(variant_name);
+  } else {
+    kernel_symbol = module->lookup_function(name);
+  }
   TI_ASSERT_INFO(kernel_symbol, "Function not found");
 
   func = (task_fp_type)kernel_symbol;
@@ -57,6 +66,11 @@ FunctionCreationGuard::FunctionCreationGuard(
 
   entry = llvm::BasicBlock::Create(*mb->llvm_context, "entry", mb->func);
 
+  old_rand_iteration = mb->rand_iteration;
+  old_rand_counter = mb->rand_counter;
+  mb->rand_iteration = nullptr;
+  mb->rand_counter = nullptr;
+
   ip = mb->builder->saveIP();
   mb->builder->SetInsertPoint(entry);
 
@@ -70,6 +84,8 @@ FunctionCreationGuard::~FunctionCreationGuard() {
   mb->builder->CreateRetVoid();
   mb->func = old_func;
   mb->builder->restoreIP(ip);
+  mb->rand_iteration = old_rand_iteration;
+  mb->rand_counter = old_rand_counter;
 
   {
     llvm::IRBuilderBase::InsertPointGuard gurad(*mb->builder);
@@ -120,8 +136,6 @@ CodeGenStmtGuard make_while_after_loop_guard(CodeGenLLVM *cg) {
 
 // CodeGenLLVM
 
-uint64 CodeGenLLVM::task_counter = 0;
-
 void CodeGenLLVM::visit(Block *stmt_list) {
   for (auto &stmt : stmt_list->statements) {
     stmt->accept(this);
@@ -139,8 +153,34 @@ void CodeGenLLVM::visit(AllocaStmt *stmt) {
 }
 
 void CodeGenLLVM::visit(RandStmt *stmt) {
+  if (!prog->config.random_counter_based) {
+    llvm_val[stmt] = create_call(
+        fmt::format("rand_{}", data_type_name(stmt->ret_type)),
+        {get_context()});
+    return;
+  }
+  if (rand_counter == nullptr) {
+    // Serial tasks (and functions outside of loop bodies) draw from a single
+    // stream
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    builder->SetInsertPoint(entry_block);
+    init_rand_stream(tlctx->get_constant(0));
+  }
   llvm_val[stmt] = create_call(
-      fmt::format("rand_{}", data_type_name(stmt->ret_type)), {get_context()});
+      fmt::format("counter_rand_{}", data_type_name(stmt->ret_type)),
+      {get_context(), tlctx->get_constant(prog->config.random_seed),
+       tlctx->get_constant(num_rand_call_sites++), rand_iteration,
+       rand_counter});
+}
+
+void CodeGenLLVM::init_rand_stream(llvm::Value *iteration) {
+  if (!prog->config.random_counter_based)
+    return;
+  // Range-for indices are i32, struct-for iterations i64
+  rand_iteration =
+      builder->CreateZExt(iteration, llvm::Type::getInt64Ty(*llvm_context));
+  rand_counter = create_entry_block_alloca(PrimitiveType::i32);
+  builder->CreateStore(tlctx->get_constant(0), rand_counter);
 }
 
 void CodeGenLLVM::emit_extra_unary(UnaryOpStmt *stmt) {
@@ -198,6 +238,10 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
   } else if (snode->type == SNodeType::pointer) {
     meta = std::make_unique<RuntimeObject>("PointerMeta", this, builder.get());
     emit_struct_meta_base("Pointer", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    meta->call("set_capacity", tlctx->get_constant(snode->hash_capacity));
   } else if (snode->type == SNodeType::root) {
     meta = std::make_unique<RuntimeObject>("RootMeta", this, builder.get());
     emit_struct_meta_base("Root", meta->ptr, snode);
@@ -205,6 +249,8 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
     meta = std::make_unique<RuntimeObject>("DynamicMeta", this, builder.get());
     emit_struct_meta_base("Dynamic", meta->ptr, snode);
     meta->call("set_chunk_size", tlctx->get_constant(snode->chunk_size));
+    meta->call("set_log2_page_size",
+               tlctx->get_constant(snode->dynamic_log2_page_size()));
   } else if (snode->type == SNodeType::bitmasked) {
     meta =
         std::make_unique<RuntimeObject>("BitmaskedMeta", this, builder.get());
@@ -257,6 +303,25 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
   for (auto const &f : functions)
     common.set(f, get_runtime_function(fmt::format("{}_{}", name, f)));
 
+  if (snode->type == SNodeType::hash) {
+    common.set("slot_to_index", get_runtime_function("Hash_slot_to_index"));
+  } else {
+    auto setter = get_runtime_function("StructMeta_set_slot_to_index");
+    common.set("slot_to_index",
+               llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+                   setter->getFunctionType()->getParamType(1))));
+  }
+
+  if (snode->type == SNodeType::bitmasked) {
+    common.set("find_next_slot",
+               get_runtime_function("Bitmasked_find_next_slot"));
+  } else {
+    auto setter = get_runtime_function("StructMeta_set_find_next_slot");
+    common.set("find_next_slot",
+               llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+                   setter->getFunctionType()->getParamType(1))));
+  }
+
   // "from_parent_element", "refine_coordinates" are different for different
   // snodes, even if they have the same type.
   if (snode->parent)
@@ -814,6 +879,10 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
     // Since there's only one container to expand, we need a special kernel for
     // more parallelism.
     call("element_listgen_root", get_runtime(), meta_parent, meta_child);
+  } else if (arch_is_cpu(current_arch()) && listgen->num_cpu_threads > 1) {
+    // Split the parent elements across the CPU thread pool.
+    call("element_listgen_nonroot_cpu", get_runtime(), meta_parent, meta_child,
+         tlctx->get_constant(listgen->num_cpu_threads));
   } else {
     call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child);
   }
@@ -821,7 +890,35 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
 
 void CodeGenLLVM::emit_gc(OffloadedStmt *stmt) {
   auto snode = stmt->snode->id;
-  call("node_gc", get_runtime(), tlctx->get_constant(snode));
+  if (arch_is_cpu(current_arch()) && prog->config.cpu_max_num_threads > 1) {
+    call("node_gc_cpu", get_runtime(), tlctx->get_constant(snode),
+         tlctx->get_constant(prog->config.cpu_max_num_threads),
+         tlctx->get_constant((int32)gc_needs_zero_fill(stmt->snode)));
+  } else {
+    call("node_gc", get_runtime(), tlctx->get_constant(snode),
+         tlctx->get_constant((int32)gc_needs_zero_fill(stmt->snode)));
+  }
+  if (stmt->snode->type == SNodeType::hash) {
+    call("Hash_gc", emit_struct_meta(stmt->snode));
+  }
+}
+
+bool CodeGenLLVM::gc_needs_zero_fill(SNode *snode) {
+  // Activating element i of a dynamic node also activates every element
+  // below i without writing them, so recycled chunks must read as zero like
+  // fresh ones. Sparse descendants hold pointers/masks, which must be cleared
+  // before reuse as well.
+  if (prog->config.gc_zero_fill ||
+      (snode->type != SNodeType::pointer && snode->type != SNodeType::hash))
+    return true;
+  std::function<bool(SNode *)> has_sparse_descendant = [&](SNode *s) {
+    for (auto &ch : s->ch) {
+      if (ch->need_activation() || has_sparse_descendant(ch.get()))
+        return true;
+    }
+    return false;
+  };
+  return has_sparse_descendant(snode);
 }
 
 llvm::Value *CodeGenLLVM::create_call(llvm::Value *func,
@@ -1882,6 +1979,7 @@ void CodeGenLLVM::visit(SNodeLookupStmt *stmt) {
     llvm_val[stmt] = builder->CreateGEP(parent, llvm_val[stmt->input_index]);
   } else if (snode->type == SNodeType::dense ||
              snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash ||
              snode->type == SNodeType::dynamic ||
              snode->type == SNodeType::bitmasked) {
     if (stmt->activate) {
@@ -1966,14 +2064,16 @@ std::string CodeGenLLVM::init_offloaded_task_function(OffloadedStmt *stmt,
                                                       std::string suffix) {
   current_loop_reentry = nullptr;
   current_while_after_loop = nullptr;
+  rand_iteration = nullptr;
+  rand_counter = nullptr;
 
   task_function_type =
       llvm::FunctionType::get(llvm::Type::getVoidTy(*llvm_context),
                               {llvm::PointerType::get(context_ty, 0)}, false);
 
-  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name, task_counter,
-                                      stmt->task_name(), suffix);
-  task_counter += 1;
+  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name,
+                                      task_counter++, stmt->task_name(),
+                                      suffix);
   func = llvm::Function::Create(task_function_type,
                                 llvm::Function::ExternalLinkage,
                                 task_kernel_name, module.get());
@@ -2047,6 +2147,18 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
   llvm::Function *body = nullptr;
   auto leaf_block = stmt->snode;
 
+  // On CPUs, TLS buffers live with the worker threads, and the runtime runs
+  // the TLS xlogues once per thread instead of once per block.
+  const bool thread_owned_tls = arch_is_cpu(current_arch());
+  // make_block_local() sets a nonzero bls_size even without BLS buffers
+  const bool has_bls = stmt->bls_prologue != nullptr;
+  auto xlogue_ptr_type = llvm::PointerType::get(get_xlogue_function_type(), 0);
+  llvm::Value *tls_prologue = llvm::ConstantPointerNull::get(xlogue_ptr_type);
+  llvm::Value *tls_epilogue = llvm::ConstantPointerNull::get(xlogue_ptr_type);
+  if (thread_owned_tls) {
+    tls_prologue = create_xlogue(stmt->tls_prologue);
+  }
+
   // When looping over bit_arrays, we always vectorize and generate struct for
   // on their parent node (usually "dense") instead of itself for higher
   // performance. Also, note that the loop must be bit_vectorized for
@@ -2076,7 +2188,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
      *
      * function_body (entry):
      *   loop_index = lower_bound;
-     *   tls_prologue()
+     *   tls_prologue() (on GPUs)
      *   bls_prologue()
      *   goto loop_test
      *
@@ -2103,7 +2215,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
      *
      * func_exit:
      *   bls_epilogue()
-     *   tls_epilogue()
+     *   tls_epilogue() (on GPUs)
      *   return
      */
 
@@ -2118,14 +2230,27 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
 
     parent_coordinates = element.get_ptr("pcoord");
 
-    if (stmt->tls_prologue) {
+    if (stmt->tls_prologue && !thread_owned_tls) {
       stmt->tls_prologue->accept(this);
     }
 
+    if (has_bls && !spmd) {
+      // Each thread stages the blocks it runs in its own stack, which stays
+      // in L1 across the block
+      bls_buffer = create_entry_block_alloca(
+          llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
+                               stmt->bls_size),
+          /*alignment=*/8);
+    }
+
     if (stmt->bls_prologue) {
-      call("block_barrier");  // "__syncthreads()"
-      stmt->bls_prologue->accept(this);
-      call("block_barrier");  // "__syncthreads()"
+      if (spmd) {
+        call("block_barrier");  // "__syncthreads()"
+        stmt->bls_prologue->accept(this);
+        call("block_barrier");  // "__syncthreads()"
+      } else {
+        create_serial_bls_xlogue(stmt, stmt->bls_prologue.get());
+      }
     }
 
     llvm::Value *thread_idx = nullptr, *block_dim = nullptr;
@@ -2169,13 +2294,19 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     // Begin loop_body_bb:
     builder->SetInsertPoint(loop_body_bb);
 
+    // Hash nodes are iterated by slot. Map the slot to the element index.
+    llvm::Value *element_index = builder->CreateLoad(loop_index);
+    if (leaf_block->type == SNodeType::hash) {
+      element_index = call(leaf_block, element.get("element"), "slot_to_index",
+                           {element_index});
+    }
+
     // initialize the coordinates
     auto refine =
         get_runtime_function(leaf_block->refine_coordinates_func_name());
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    create_call(refine, {parent_coordinates, new_coordinates,
-                         builder->CreateLoad(loop_index)});
+    create_call(refine, {parent_coordinates, new_coordinates, element_index});
 
     current_coordinates = new_coordinates;
 
@@ -2194,6 +2325,12 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       }
     }
 
+    if (snode->type == SNodeType::hash) {
+      // Empty slots and inactive elements are mapped to -1
+      exec_cond = builder->CreateICmp(llvm::CmpInst::ICMP_SGE, element_index,
+                                      tlctx->get_constant(0));
+    }
+
     auto coord_object = RuntimeObject("PhysicalCoordinates", this,
                                       builder.get(), new_coordinates);
     for (int i = 0; i < snode->num_active_indices; i++) {
@@ -2218,10 +2355,34 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       exec_cond = builder->CreateAnd(exec_cond, is_active);
     }
 
+    // Key the random numbers of the iteration by its linearized coordinates.
+    // Sparse domains easily exceed 2^32 cells, so linearize in 64 bits. The
+    // physical coordinates are bit-packed, and their lowest |start| bits are
+    // always zero at this level.
+    llvm::Value *iteration = tlctx->get_constant((int64)0);
+    if (prog->config.random_counter_based) {
+      auto top = leaf_block;
+      while (top->parent != nullptr && top->parent->type != SNodeType::root)
+        top = top->parent;
+      for (int i = 0; i < leaf_block->num_active_indices; i++) {
+        auto j = leaf_block->physical_index_position[i];
+        auto start = leaf_block->extractors[j].start;
+        auto num_bits =
+            top->extractors[j].start + top->extractors[j].num_bits - start;
+        auto coord = builder->CreateLShr(
+            builder->CreateZExt(coord_object.get("val", tlctx->get_constant(j)),
+                                llvm::Type::getInt64Ty(*llvm_context)),
+            (uint64)start);
+        iteration = builder->CreateOr(
+            builder->CreateShl(iteration, (uint64)num_bits), coord);
+      }
+    }
+
     builder->CreateCondBr(exec_cond, struct_for_body_bb, body_tail_bb);
 
     {
       builder->SetInsertPoint(struct_for_body_bb);
+      init_rand_stream(iteration);
 
       // The real loop body of the StructForStmt
       stmt->body->accept(this);
@@ -2244,22 +2405,47 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     }
 
     if (stmt->bls_epilogue) {
-      call("block_barrier");  // "__syncthreads()"
-      stmt->bls_epilogue->accept(this);
-      call("block_barrier");  // "__syncthreads()"
+      if (spmd) {
+        call("block_barrier");  // "__syncthreads()"
+        stmt->bls_epilogue->accept(this);
+        call("block_barrier");  // "__syncthreads()"
+      } else {
+        create_serial_bls_xlogue(stmt, stmt->bls_epilogue.get());
+      }
     }
 
-    if (stmt->tls_epilogue) {
+    if (stmt->tls_epilogue && !thread_owned_tls) {
       stmt->tls_epilogue->accept(this);
     }
   }
 
+  if (thread_owned_tls) {
+    tls_epilogue = create_xlogue(stmt->tls_epilogue);
+  }
+
   int list_element_size = std::min(leaf_block->max_num_elements(),
                                    (int64)taichi_listgen_max_element_size);
   int num_splits = std::max(1, list_element_size / stmt->block_dim);
+  if (has_bls && !spmd) {
+    // The BLS xlogues cover the whole block, so do not split it across CPU
+    // tasks, each of which would stage it again
+    num_splits = 1;
+  }
 
   auto struct_for_func = get_runtime_function("parallel_struct_for");
 
+  // On CPUs, let the runtime skip inactive cells of bitmasked leaf blocks
+  // by whole mask words. Each run of active cells is a call to |body|, so
+  // not with BLS, whose xlogues |body| runs on every call.
+  llvm::Value *leaf_meta = nullptr;
+  if (arch_is_cpu(current_arch()) &&
+      leaf_block->type == SNodeType::bitmasked && !has_bls) {
+    leaf_meta = cast_pointer(emit_struct_meta(leaf_block), "StructMeta");
+  } else {
+    leaf_meta = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+        struct_for_func->getFunctionType()->getParamType(4)));
+  }
+
   if (arch_is_gpu(current_arch())) {
     // Note that on CUDA local array allocation must have a compile-time
     // constant size. Therefore, instead of passing in the tls_buffer_size
@@ -2303,11 +2489,40 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       struct_for_func,
       {get_context(), tlctx->get_constant(leaf_block->id),
        tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
-       body, tlctx->get_constant(stmt->tls_size),
+       leaf_meta, body, tls_prologue, tls_epilogue,
+       tlctx->get_constant(stmt->tls_size),
        tlctx->get_constant(stmt->num_cpu_threads)});
   // TODO: why do we need num_cpu_threads on GPUs?
 }
 
+void CodeGenLLVM::create_serial_bls_xlogue(OffloadedStmt *stmt,
+                                           Block *xlogue) {
+  using namespace llvm;
+  auto thread_idx =
+      create_entry_block_alloca(llvm::Type::getInt32Ty(*llvm_context));
+  builder->CreateStore(tlctx->get_constant(0), thread_idx);
+
+  auto test_bb = BasicBlock::Create(*llvm_context, "bls_xlogue_test", func);
+  auto body_bb = BasicBlock::Create(*llvm_context, "bls_xlogue_body", func);
+  auto after_bb = BasicBlock::Create(*llvm_context, "bls_xlogue_after", func);
+  builder->CreateBr(test_bb);
+
+  builder->SetInsertPoint(test_bb);
+  auto cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
+                                  builder->CreateLoad(thread_idx),
+                                  tlctx->get_constant(stmt->block_dim));
+  builder->CreateCondBr(cond, body_bb, after_bb);
+
+  builder->SetInsertPoint(body_bb);
+  bls_thread_idx = thread_idx;
+  xlogue->accept(this);
+  bls_thread_idx = nullptr;
+  create_increment(thread_idx, tlctx->get_constant(1));
+  builder->CreateBr(test_bb);
+
+  builder->SetInsertPoint(after_bb);
+}
+
 void CodeGenLLVM::visit(LoopIndexStmt *stmt) {
   if (stmt->loop->is<OffloadedStmt>() &&
       stmt->loop->as<OffloadedStmt>()->task_type ==
@@ -2325,7 +2540,10 @@ void CodeGenLLVM::visit(LoopLinearIndexStmt *stmt) {
   if (stmt->loop->is<OffloadedStmt>() &&
       stmt->loop->as<OffloadedStmt>()->task_type ==
           OffloadedStmt::TaskType::struct_for) {
-    llvm_val[stmt] = create_call("thread_idx");
+    if (bls_thread_idx)
+      llvm_val[stmt] = builder->CreateLoad(bls_thread_idx);
+    else
+      llvm_val[stmt] = create_call("thread_idx");
   } else {
     TI_NOT_IMPLEMENTED;
   }
@@ -2395,8 +2613,10 @@ void CodeGenLLVM::visit(InternalFuncStmt *stmt) {
 
 void CodeGenLLVM::visit(StackAllocaStmt *stmt) {
   TI_ASSERT(stmt->width() == 1);
-  auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
-                                   stmt->size_in_bytes());
+  auto type = llvm::ArrayType::get(
+      llvm::Type::getInt8Ty(*llvm_context),
+      taichi_ad_stack_header_size +
+          stmt->entry_size_in_bytes() * stmt->max_size);
   auto alloca = create_entry_block_alloca(type, sizeof(int64));
   llvm_val[stmt] = builder->CreateBitCast(
       alloca, llvm::PointerType::getInt8PtrTy(*llvm_context));
@@ -2404,14 +2624,19 @@ void CodeGenLLVM::visit(StackAllocaStmt *stmt) {
 }
 
 void CodeGenLLVM::visit(StackPopStmt *stmt) {
-  call("stack_pop", llvm_val[stmt->stack]);
+  auto stack = stmt->stack->as<StackAllocaStmt>();
+  call("stack_pop", get_runtime(), llvm_val[stack],
+       tlctx->get_constant(stack->max_size),
+       tlctx->get_constant(stack->element_size_in_bytes()));
 }
 
 void CodeGenLLVM::visit(StackPushStmt *stmt) {
   auto stack = stmt->stack->as<StackAllocaStmt>();
-  call("stack_push", llvm_val[stack], tlctx->get_constant(stack->max_size),
+  call("stack_push", get_runtime(), llvm_val[stack],
+       tlctx->get_constant(stack->max_size),
        tlctx->get_constant(stack->element_size_in_bytes()));
   auto primal_ptr = call("stack_top_primal", llvm_val[stack],
+                         tlctx->get_constant(stack->max_size),
                          tlctx->get_constant(stack->element_size_in_bytes()));
   primal_ptr = builder->CreateBitCast(
       primal_ptr,
@@ -2422,6 +2647,7 @@ void CodeGenLLVM::visit(StackPushStmt *stmt) {
 void CodeGenLLVM::visit(StackLoadTopStmt *stmt) {
   auto stack = stmt->stack->as<StackAllocaStmt>();
   auto primal_ptr = call("stack_top_primal", llvm_val[stack],
+                         tlctx->get_constant(stack->max_size),
                          tlctx->get_constant(stack->element_size_in_bytes()));
   primal_ptr = builder->CreateBitCast(
       primal_ptr,
@@ -2432,6 +2658,7 @@ void CodeGenLLVM::visit(StackLoadTopStmt *stmt) {
 void CodeGenLLVM::visit(StackLoadTopAdjStmt *stmt) {
   auto stack = stmt->stack->as<StackAllocaStmt>();
   auto adjoint = call("stack_top_adjoint", llvm_val[stack],
+                      tlctx->get_constant(stack->max_size),
                       tlctx->get_constant(stack->element_size_in_bytes()));
   adjoint = builder->CreateBitCast(
       adjoint, llvm::PointerType::get(tlctx->get_data_type(stmt->ret_type), 0));
@@ -2441,6 +2668,7 @@ void CodeGenLLVM::visit(StackLoadTopAdjStmt *stmt) {
 void CodeGenLLVM::visit(StackAccAdjointStmt *stmt) {
   auto stack = stmt->stack->as<StackAllocaStmt>();
   auto adjoint_ptr = call("stack_top_adjoint", llvm_val[stack],
+                          tlctx->get_constant(stack->max_size),
                           tlctx->get_constant(stack->element_size_in_bytes()));
   adjoint_ptr = builder->CreateBitCast(
       adjoint_ptr,
@@ -2470,25 +2698,82 @@ void CodeGenLLVM::eliminate_unused_functions() {
       });
 }
 
-FunctionType CodeGenLLVM::compile_module_to_executable() {
+void CodeGenLLVM::compile_module_to_tasks() {
   TI_AUTO_PROF
   eliminate_unused_functions();
 
-  tlctx->add_module(std::move(module));
+  std::unique_ptr<llvm::Module> variant_module;
+  auto &variant_cpu = prog->config.cpu_multiversioning_target;
+  if (arch_is_cpu(kernel->arch) && !variant_cpu.empty())
+    variant_module = create_cpu_variant_module(variant_cpu);
+
+  auto jit_module = tlctx->add_module(std::move(module), fast_compile);
+  JITModule *variant_jit_module = nullptr;
+  if (variant_module)
+    variant_jit_module =
+        tlctx->add_module(std::move(variant_module), fast_compile);
 
   for (auto &task : offloaded_tasks) {
-    task.compile();
+    task.compile(jit_module, variant_jit_module);
   }
-  auto offloaded_tasks_local = offloaded_tasks;
+}
+
+std::unique_ptr<llvm::Module> CodeGenLLVM::create_cpu_variant_module(
+    const std::string &cpu) {
+  TI_AUTO_PROF
+  auto variant_module = llvm::CloneModule(*module);
+  std::unordered_set<std::string> variant_names;
+  for (auto &task : offloaded_tasks) {
+    // Serial tasks are not worth compiling twice
+    if (task.num_cpu_threads <= 1)
+      continue;
+    task.variant_name = fmt::format("{}_{}", task.name, cpu);
+    variant_module->getFunction(task.name)->setName(task.variant_name);
+    variant_names.insert(task.variant_name);
+  }
+  if (variant_names.empty())
+    return nullptr;
+  TaichiLLVMContext::eliminate_unused_functions(
+      variant_module.get(), [&](const std::string &func_name) {
+        return variant_names.count(func_name) != 0;
+      });
+  // The subtarget of each function follows these attributes, which also
+  // override those of the runtime functions
+  for (auto &f : *variant_module) {
+    if (f.isDeclaration())
+      continue;
+    f.addFnAttr("target-cpu", cpu);
+    f.addFnAttr("target-features", "");
+  }
+  return variant_module;
+}
+
+FunctionType CodeGenLLVM::create_launcher(
+    Program *prog,
+    const std::string &kernel_name,
+    const std::vector<OffloadedTask> &tasks) {
+  auto offloaded_tasks_local = tasks;
   auto kernel_name_ = kernel_name;
+  auto autotuner = prog->cpu_autotuner.get();
   return [=](Context &context) {
     TI_TRACE("Launching kernel {}", kernel_name_);
     for (auto task : offloaded_tasks_local) {
-      task(&context);
+      if (autotuner && task.autotune_kind) {
+        autotuner->launch(task.autotune_key, *task.autotune_kind,
+                          task.num_cpu_threads, &context,
+                          [&] { task(&context); });
+      } else {
+        task(&context);
+      }
     }
   };
 }
 
+FunctionType CodeGenLLVM::compile_module_to_executable() {
+  compile_module_to_tasks();
+  return create_launcher(prog, kernel_name, offloaded_tasks);
+}
+
 FunctionCreationGuard CodeGenLLVM::get_function_creation_guard(
     std::vector<llvm::Type *> argument_types) {
   return FunctionCreationGuard(this, argument_types);
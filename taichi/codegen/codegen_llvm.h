@@ -22,6 +22,13 @@ class OffloadedTask {
   int block_dim;
   int grid_dim;
   std::size_t shmem_bytes{0};
+  // Set for CPU tasks whose launch parameters the autotuner may change
+  std::optional<CPUAutotuner::TaskKind> autotune_kind;
+  std::string autotune_key;
+  int num_cpu_threads{1};
+  // Set for CPU tasks also compiled for config.cpu_multiversioning_target:
+  // the name of that variant
+  std::string variant_name;
 
   OffloadedTask(CodeGenLLVM *codegen);
 
@@ -29,7 +36,9 @@ class OffloadedTask {
 
   void end();
 
-  void compile();
+  // Looks the task function (or its variant) up in the JIT modules it was
+  // added to. Task names are only unique within a kernel compilation.
+  void compile(JITModule *module, JITModule *variant_module = nullptr);
 
   void operator()(Context *context);
 };
@@ -40,6 +49,7 @@ class FunctionCreationGuard {
   llvm::Function *old_func;
   llvm::Function *body;
   llvm::BasicBlock *old_entry, *allocas, *entry;
+  llvm::Value *old_rand_iteration, *old_rand_counter;
   llvm::IRBuilder<>::InsertPoint ip;
 
   FunctionCreationGuard(CodeGenLLVM *mb, std::vector<llvm::Type *> arguments);
@@ -49,18 +59,30 @@ class FunctionCreationGuard {
 
 class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
  public:
-  static uint64 task_counter;
-
   Kernel *kernel;
   IRNode *ir;
   Program *prog;
   std::string kernel_name;
+  // Index of the next task function, which is part of its name. Task names
+  // must not depend on what else the process compiled, since the kernel cache
+  // hashes the module text.
+  int task_counter{0};
   std::vector<llvm::Value *> kernel_args;
   llvm::Type *context_ty;
   llvm::Type *physical_coordinate_ty;
   llvm::Value *current_coordinates;
+  // For counter-based ti.random() (see CompileConfig::random_counter_based):
+  // the loop iteration run by the current function, and the number of random
+  // numbers it has drawn so far
+  llvm::Value *rand_iteration{nullptr};
+  llvm::Value *rand_counter{nullptr};
+  int num_rand_call_sites{0};
   llvm::Value *parent_coordinates{nullptr};
-  llvm::GlobalVariable *bls_buffer{nullptr};
+  // Shared memory on GPUs, and a stack array of the struct-for body function
+  // on CPUs
+  llvm::Value *bls_buffer{nullptr};
+  // On CPUs, the thread of the block emulated by create_serial_bls_xlogue()
+  llvm::Value *bls_thread_idx{nullptr};
   // Mainly for supporting continue stmt
   llvm::BasicBlock *current_loop_reentry;
   // Mainly for supporting break stmt
@@ -74,6 +96,8 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   llvm::BasicBlock *func_body_bb;
 
   std::unordered_map<const Stmt *, std::vector<llvm::Value *>> loop_vars_llvm;
+  // See KernelCodeGen::fast_compile
+  bool fast_compile{false};
 
   using IRVisitor::visit;
   using LLVMModuleBuilder::call;
@@ -114,6 +138,19 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void eliminate_unused_functions();
 
+  // Compiles |module| and looks up the functions of |offloaded_tasks|.
+  void compile_module_to_tasks();
+
+  // Returns a copy of |module| with only the parallel tasks, compiled for the
+  // LLVM CPU |cpu| and renamed to their variant_name.
+  std::unique_ptr<llvm::Module> create_cpu_variant_module(
+      const std::string &cpu);
+
+  // Returns a function launching |tasks| in order.
+  static FunctionType create_launcher(Program *prog,
+                                      const std::string &kernel_name,
+                                      const std::vector<OffloadedTask> &tasks);
+
   virtual FunctionType compile_module_to_executable();
 
   virtual FunctionType gen();
@@ -133,6 +170,8 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void emit_gc(OffloadedStmt *stmt);
 
+  bool gc_needs_zero_fill(SNode *snode);
+
   llvm::Value *create_call(llvm::Value *func,
                            std::vector<llvm::Value *> args = {});
 
@@ -160,6 +199,9 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void visit(RandStmt *stmt) override;
 
+  // Starts the random number stream of loop iteration |iteration|
+  void init_rand_stream(llvm::Value *iteration);
+
   llvm::Value *cast_int(llvm::Value *input_val, Type *from, Type *to);
 
   virtual void emit_extra_unary(UnaryOpStmt *stmt);
@@ -334,6 +376,10 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *create_xlogue(std::unique_ptr<Block> &block);
 
+  // On CPUs, the BLS xlogues of a struct-for block are run by the thread
+  // running the block: loop over the block_dim threads that run them on GPUs.
+  void create_serial_bls_xlogue(OffloadedStmt *stmt, Block *xlogue);
+
   llvm::Value *extract_exponent_from_float(llvm::Value *f);
 
   llvm::Value *extract_digits_from_float(llvm::Value *f, bool full);
@@ -19,6 +19,21 @@ constexpr std::size_t taichi_result_buffer_error_id = 1;
 constexpr std::size_t taichi_result_buffer_runtime_query_id = 2;
 
 constexpr int taichi_listgen_max_element_size = 1024;
+// Upper bound of the number of per-task buffers used by the parallel CPU
+// listgen
+constexpr int taichi_listgen_max_num_cpu_tasks = 256;
+
+// Number of free nodes a CPU thread takes from a NodeManager at a time, when
+// per-thread allocation magazines are enabled
+constexpr int taichi_node_magazine_size = 64;
+
+// Number of slots of a hash SNode, unless specified otherwise
+constexpr int taichi_default_hash_capacity = 65536;
+
+// Bytes before the inline entries of an autodiff stack in the LLVM runtime
+constexpr std::size_t taichi_ad_stack_header_size = 16;
+// Size of the heap chunks that overflowing autodiff stacks spill to
+constexpr std::size_t taichi_ad_stack_spill_chunk_size = 4096;
 
 template <typename T, typename G>
 T taichi_union_cast_with_different_sizes(G g) {
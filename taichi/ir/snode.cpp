@@ -125,6 +125,31 @@ SNode &SNode::dynamic(const Index &expr, int n, int chunk_size) {
   return snode;
 }
 
+SNode &SNode::hash(const std::vector<Index> &indices,
+                   const std::vector<int> &sizes,
+                   int capacity) {
+  TI_ASSERT(capacity >= 0);
+  auto &snode = create_node(indices, sizes, SNodeType::hash);
+  snode.hash_capacity = capacity;
+  return snode;
+}
+
+int SNode::morton_bit_position(int i, int bit) const {
+  TI_ASSERT(0 <= bit && bit < extractors[i].num_bits);
+  // Bits of different indices are interleaved round-robin. Like the row-major
+  // layout, the last physical index takes the least significant bit.
+  int position = 0;
+  for (int b = 0;; b++) {
+    for (int k = taichi_max_num_indices - 1; k >= 0; k--) {
+      if (b < extractors[k].num_bits) {
+        if (k == i && b == bit)
+          return position;
+        position++;
+      }
+    }
+  }
+}
+
 SNode &SNode::bit_struct(int num_bits) {
   auto &snode = create_node({}, {}, SNodeType::bit_struct);
   snode.physical_type =
@@ -259,6 +284,17 @@ int SNode::shape_along_axis(int i) const {
   return extractor.num_elements * (1 << extractor.trailing_bits);
 }
 
+// Dynamic SNodes index their chunks with a two-level directory, whose levels
+// hold 2^dynamic_log2_page_size() pointers each (see node_dynamic.h). Returns
+// -1 if the node has a single chunk, which needs no directory.
+int SNode::dynamic_log2_page_size() const {
+  TI_ASSERT(type == SNodeType::dynamic);
+  int64 num_chunks = (max_num_elements() + chunk_size - 1) / chunk_size;
+  if (num_chunks <= 1)
+    return -1;
+  return (bit::ceil_log2int(num_chunks) + 1) / 2;
+}
+
 SNode::SNode() : SNode(0, SNodeType::undefined) {
 }
 
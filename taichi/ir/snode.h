@@ -77,6 +77,7 @@ class SNode {
   int total_num_bits{0};
   int total_bit_start{0};
   int chunk_size{0};
+  int hash_capacity{0};  // for hash only. 0 means the default capacity
   std::size_t cell_size_bytes{0};
   PrimitiveType *physical_type;  // for bit_struct and bit_array only
   DataType dt;
@@ -180,6 +181,10 @@ class SNode {
     return hash(std::vector<Index>{index}, size);
   }
 
+  SNode &hash(const std::vector<Index> &indices,
+              const std::vector<int> &sizes,
+              int capacity);
+
   std::string type_name() {
     return snode_type_name(type);
   }
@@ -203,6 +208,10 @@ class SNode {
     return *this;
   }
 
+  // For Morton (Z-order) layouts: the position of the |bit|-th bit of the
+  // physical index |i| in the linearized element index of this node.
+  int morton_bit_position(int i, int bit) const;
+
   // for float and double
   void write_float(const std::vector<int> &I, float64);
   float64 read_float(const std::vector<int> &I);
@@ -274,6 +283,9 @@ class SNode {
 
   int shape_along_axis(int i) const;
 
+  // For dynamic only. See the definition.
+  int dynamic_log2_page_size() const;
+
   uint64 fetch_reader_result();  // TODO: refactor
 
   void begin_shared_exp_placement();
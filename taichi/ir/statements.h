@@ -1047,7 +1047,9 @@ class InternalFuncStmt : public Stmt {
 class StackAllocaStmt : public Stmt {
  public:
   DataType dt;
-  std::size_t max_size;  // TODO: 0 = adaptive
+  // Number of entries stored inline. The LLVM backends spill further entries
+  // to the heap; the other backends treat it as a hard limit.
+  std::size_t max_size;
 
   StackAllocaStmt(DataType dt, std::size_t max_size)
       : dt(dt), max_size(max_size) {
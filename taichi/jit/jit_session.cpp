@@ -1,6 +1,7 @@
 #include "taichi/jit/jit_session.h"
 
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Module.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -20,6 +21,10 @@ std::unique_ptr<JITSession> JITSession::create(Arch arch) {
     TI_NOT_IMPLEMENTED
 }
 
+JITModule *JITSession::add_module_fast(std::unique_ptr<llvm::Module> M) {
+  return add_module(std::move(M));
+}
+
 std::size_t JITSession::get_type_size(llvm::Type *type) {
   return get_data_layout().getTypeAllocSize(type);
 }
@@ -22,12 +22,20 @@ class JITSession {
   virtual JITModule *add_module(std::unique_ptr<llvm::Module> M,
                                 int max_reg = 0) = 0;
 
+  // Like add_module(), but with minimal optimization, to compile quickly
+  virtual JITModule *add_module_fast(std::unique_ptr<llvm::Module> M);
+
   // virtual void remove_module(JITModule *module) = 0;
 
   virtual void *lookup(const std::string Name) {
     TI_NOT_IMPLEMENTED
   }
 
+  // Whether the host CPU can run code compiled for the LLVM CPU |cpu|
+  virtual bool host_supports_cpu(const std::string &cpu) {
+    return false;
+  }
+
   virtual llvm::DataLayout get_data_layout();
 
   std::size_t get_type_size(llvm::Type *type);
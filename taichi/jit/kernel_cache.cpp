@@ -0,0 +1,151 @@
+#include "taichi/jit/kernel_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "taichi/util/statistics.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char *kEntrySuffix = ".o";
+
+std::optional<std::string> read_file(const std::string &filename) {
+  std::ifstream ifs(filename, std::ios::binary);
+  if (!ifs)
+    return std::nullopt;
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+bool is_entry(const fs::directory_entry &entry) {
+  return entry.is_regular_file() && entry.path().extension() == kEntrySuffix;
+}
+
+}  // namespace
+
+KernelCache::KernelCache(const std::string &path, std::size_t max_size_bytes)
+    : path_(path), max_size_bytes_(max_size_bytes) {
+  std::error_code ec;
+  fs::create_directories(path_, ec);
+  if (ec) {
+    TI_WARN("Failed to create kernel cache directory {}: {}", path_,
+            ec.message());
+    return;
+  }
+  auto version_file = path_ + "/version";
+  auto version = get_version();
+  bool outdated = read_file(version_file) != version;
+  for (auto &entry : fs::directory_iterator(path_, ec)) {
+    if (!is_entry(entry))
+      continue;
+    if (outdated) {
+      fs::remove(entry.path(), ec);
+    } else {
+      total_size_bytes_ += entry.file_size(ec);
+    }
+  }
+  if (outdated) {
+    TI_TRACE("Kernel cache {} is outdated and has been cleared", path_);
+    std::ofstream(version_file, std::ios::binary) << version;
+  }
+}
+
+std::string KernelCache::get_entry_path(const std::string &key) const {
+  return fmt::format("{}/{}{}", path_, key, kEntrySuffix);
+}
+
+std::optional<std::string> KernelCache::load(const std::string &key) {
+  auto filename = get_entry_path(key);
+  auto data = read_file(filename);
+  std::lock_guard<std::mutex> _(mut_);
+  if (!data) {
+    stats_.misses++;
+    stat.add("kernel_cache_misses");
+    return std::nullopt;
+  }
+  // Mark the entry as recently used
+  std::error_code ec;
+  fs::last_write_time(filename, fs::file_time_type::clock::now(), ec);
+  stats_.hits++;
+  stat.add("kernel_cache_hits");
+  return data;
+}
+
+void KernelCache::store(const std::string &key, const std::string &data) {
+  auto filename = get_entry_path(key);
+  // Write to a temporary file first, so that other processes never see a
+  // partially written entry.
+  auto temp_filename =
+      fmt::format("{}.{:x}.tmp", filename, std::random_device{}());
+  {
+    std::ofstream ofs(temp_filename, std::ios::binary);
+    if (!ofs)
+      return;
+    ofs.write(data.data(), data.size());
+  }
+  std::error_code ec;
+  fs::rename(temp_filename, filename, ec);
+  if (ec) {
+    fs::remove(temp_filename, ec);
+    return;
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  total_size_bytes_ += data.size();
+  if (total_size_bytes_ > max_size_bytes_)
+    evict();
+}
+
+void KernelCache::evict() {
+  // Other processes may have added entries, so rescan the directory.
+  std::vector<std::pair<fs::file_time_type, fs::directory_entry>> entries;
+  std::error_code ec;
+  total_size_bytes_ = 0;
+  for (auto &entry : fs::directory_iterator(path_, ec)) {
+    if (!is_entry(entry))
+      continue;
+    total_size_bytes_ += entry.file_size(ec);
+    entries.emplace_back(entry.last_write_time(ec), entry);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  // Evict down to 3/4 of the limit, so that eviction does not run for every
+  // new entry.
+  auto target_size = max_size_bytes_ / 4 * 3;
+  for (auto &[time, entry] : entries) {
+    if (total_size_bytes_ <= target_size)
+      break;
+    auto size = entry.file_size(ec);
+    if (fs::remove(entry.path(), ec)) {
+      total_size_bytes_ -= size;
+      stats_.evictions++;
+      stat.add("kernel_cache_evictions");
+    }
+  }
+}
+
+KernelCache::Stats KernelCache::get_stats() {
+  std::lock_guard<std::mutex> _(mut_);
+  return stats_;
+}
+
+std::string KernelCache::get_default_path() {
+  if (auto home = std::getenv("HOME"))
+    return fmt::format("{}/.cache/taichi/kernels", home);
+  return (fs::temp_directory_path() / "taichi" / "kernels").string();
+}
+
+std::string KernelCache::get_version() {
+  return fmt::format("{} {} llvm-{}", get_version_string(), get_commit_hash(),
+                     get_llvm_version_string());
+}
+
+TLANG_NAMESPACE_END
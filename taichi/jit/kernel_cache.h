@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+// A size-bounded on-disk cache of compiled kernel objects, shared by all
+// processes using the same directory.
+//
+// Each entry is a file named after its key. Loading an entry refreshes its
+// modification time, and once the total size exceeds the limit the entries
+// modified least recently are evicted. The directory remembers the version
+// (Taichi, commit and LLVM) of the process that populated it, and a process
+// with a different version wipes it.
+class KernelCache {
+ public:
+  struct Stats {
+    int64 hits{0};
+    int64 misses{0};
+    int64 evictions{0};
+  };
+
+  KernelCache(const std::string &path, std::size_t max_size_bytes);
+
+  // Returns the data of |key|, or std::nullopt on a miss.
+  std::optional<std::string> load(const std::string &key);
+
+  void store(const std::string &key, const std::string &data);
+
+  Stats get_stats();
+
+  static std::string get_default_path();
+
+  static std::string get_version();
+
+ private:
+  std::string get_entry_path(const std::string &key) const;
+
+  void evict();
+
+  std::string path_;
+  std::size_t max_size_bytes_;
+  std::size_t total_size_bytes_{0};
+  Stats stats_;
+  std::mutex mut_;
+};
+
+TLANG_NAMESPACE_END
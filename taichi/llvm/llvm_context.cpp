@@ -676,7 +676,10 @@ llvm::DataLayout TaichiLLVMContext::get_data_layout() {
   return jit->get_data_layout();
 }
 
-JITModule *TaichiLLVMContext::add_module(std::unique_ptr<llvm::Module> module) {
+JITModule *TaichiLLVMContext::add_module(std::unique_ptr<llvm::Module> module,
+                                         bool fast_compile) {
+  if (fast_compile)
+    return jit->add_module_fast(std::move(module));
   return jit->add_module(std::move(module));
 }
 
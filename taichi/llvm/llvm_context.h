@@ -54,7 +54,8 @@ class TaichiLLVMContext {
 
   void set_struct_module(const std::unique_ptr<llvm::Module> &module);
 
-  JITModule *add_module(std::unique_ptr<llvm::Module> module);
+  JITModule *add_module(std::unique_ptr<llvm::Module> module,
+                        bool fast_compile = false);
 
   virtual void *lookup_function_pointer(const std::string &name) {
     return jit->lookup(name);
@@ -72,6 +72,32 @@ class ParallelExecutor {
   std::condition_variable flush_cv_;
 };
 
+// Wraps an executable function that is compiled asynchronously, e.g. from a
+// task, or for tiered compilation.
+class AsyncCompiledFunc {
+ public:
+  AsyncCompiledFunc() : f_(p_.get_future()) {
+  }
+
+  inline void set(const FunctionType &func) {
+    p_.set_value(func);
+  }
+
+  inline FunctionType get() {
+    return f_.get();
+  }
+
+  // Whether get() returns without blocking
+  inline bool ready() const {
+    return f_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+ private:
+  std::promise<FunctionType> p_;
+  // https://stackoverflow.com/questions/38160960/calling-stdfutureget-repeatedly
+  std::shared_future<FunctionType> f_;
+};
+
 // Compiles the offloaded and optimized IR to the target backend's executable.
 using BackendExecCompilationFunc =
     std::function<FunctionType(Kernel &, OffloadedStmt *)>;
@@ -102,25 +128,6 @@ class ExecutionQueue {
   void synchronize();
 
  private:
-  // Wraps an executable function that is compiled from a task asynchronously.
-  class AsyncCompiledFunc {
-   public:
-    AsyncCompiledFunc() : f_(p_.get_future()) {
-    }
-
-    inline void set(const FunctionType &func) {
-      p_.set_value(func);
-    }
-
-    inline FunctionType get() {
-      return f_.get();
-    }
-
-   private:
-    std::promise<FunctionType> p_;
-    // https://stackoverflow.com/questions/38160960/calling-stdfutureget-repeatedly
-    std::shared_future<FunctionType> f_;
-  };
   std::unordered_map<uint64, AsyncCompiledFunc> compiled_funcs_;
 
   IRBank *ir_bank_;  // not owned
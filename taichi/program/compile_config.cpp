@@ -42,10 +42,32 @@ CompileConfig::CompileConfig() {
   saturating_grid_dim = 0;
   max_block_dim = 0;
   cpu_max_num_threads = std::thread::hardware_concurrency();
+  cpu_work_stealing = false;
+  cpu_alloc_magazines = false;
+  cpu_numa = false;
+  cpu_numa_memory_policy = "first_touch";
+  cpu_huge_pages = false;
+  cpu_autotune = false;
+  cpu_autotune_trials = 2;
+  cpu_autotune_file = "";
+  cpu_simd_width = 0;
 
   ad_stack_size = 16;
+  random_counter_based = false;
+  random_seed = 0;
+  gc_zero_fill = true;
+  gc_decommit = false;
 
   // LLVM backend options:
+  kernel_cache = false;
+  kernel_cache_path = "";
+  kernel_cache_max_size_MB = 1024;
+  num_compile_threads = 4;
+  cpu_target = "native";
+  cpu_features = "";
+  cpu_multiversioning_target = "";
+  tiered_compilation = false;
+  tiered_compilation_threshold = 16;
   print_struct_llvm_ir = false;
   print_kernel_llvm_ir = false;
   print_kernel_nvptx = false;
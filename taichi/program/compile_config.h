@@ -42,12 +42,79 @@ struct CompileConfig {
   int default_gpu_block_dim;
   int gpu_max_reg;
   int ad_stack_size;
+  // Make ti.random() a stateless function of (random_seed, call site, loop
+  // iteration, call count in the iteration), so that its results do not
+  // depend on thread scheduling. LLVM backends only.
+  bool random_counter_based;
+  int random_seed;
+  // Zero-fill the deactivated nodes of pointer SNodes during GC. Disabling it
+  // is only safe when cells are always written before being read after
+  // activation.
+  bool gc_zero_fill;
+  // Return the memory of sparse node chunks without any allocated node to the
+  // OS after each GC, so that RSS shrinks with the data structure. CPU only.
+  // On Windows the commit charge stays (see VirtualMemoryAllocator::decommit).
+  bool gc_decommit;
 
   int saturating_grid_dim;
   int max_block_dim;
   int cpu_max_num_threads;
+  // Use the work-stealing CPU thread pool (spinning workers, lock-free
+  // completion) instead of the default mutex/condition variable one.
+  bool cpu_work_stealing;
+  // Let each CPU thread allocate sparse nodes from a private batch
+  // ("magazine") of free nodes, instead of bumping the shared free list
+  // cursor for every activation.
+  bool cpu_alloc_magazines;
+  // NUMA mode: pin the thread pool workers to cores and use the
+  // work-stealing pool, whose initial contiguous task partition makes each
+  // thread touch the same pages of a dense loop across launches.
+  bool cpu_numa;
+  // NUMA policy of CPU memory: "first_touch", "interleave", or "bind:<node>".
+  std::string cpu_numa_memory_policy;
+  // Back CPU memory (the root buffer and sparse node chunks) with 2 MB
+  // transparent huge pages, to reduce TLB misses on large fields.
+  bool cpu_huge_pages;
+  // Time the first launches of each CPU range-for and struct-for task with
+  // different block_dim/element_split/thread counts, and use the fastest
+  // choice afterwards. Choices are loaded from and saved to
+  // cpu_autotune_file, if set.
+  bool cpu_autotune;
+  int cpu_autotune_trials;
+  std::string cpu_autotune_file;
+  // Vector width of range-for bodies. Bodies run on a block of consecutive
+  // indices per call, in a loop LLVM vectorizes; 0 lets LLVM choose the
+  // width, and 1 calls the scalar body once per index instead.
+  int cpu_simd_width;
 
   // LLVM backend options:
+  // Keep the compiled objects of CPU kernels (and of the runtime) in an
+  // on-disk cache at kernel_cache_path, so that later processes can skip
+  // LLVM optimization and code generation. The default path is
+  // ~/.cache/taichi/kernels.
+  bool kernel_cache;
+  std::string kernel_cache_path;
+  int kernel_cache_max_size_MB;
+  // In sync mode, generate and compile the offloaded tasks of a CPU kernel as
+  // separate modules on this many threads. Values below 2 compile kernels
+  // as a single module.
+  int num_compile_threads;
+  // LLVM CPU (e.g. "haswell", "skylake-avx512") that CPU kernels are compiled
+  // for, and features (e.g. "+avx2,-avx512f") added to it. "native" is the
+  // host CPU with all of its features. Pin these to share the kernel cache
+  // across different machines. A target that is unknown or that the host
+  // cannot run falls back to "native" with a warning.
+  std::string cpu_target;
+  std::string cpu_features;
+  // If set, parallel CPU tasks are also compiled for this LLVM CPU, and the
+  // variant is used on hosts whose CPUID reports all of its features.
+  std::string cpu_multiversioning_target;
+  // Tiered compilation (CPUs, sync mode): kernels are first compiled with
+  // minimal LLVM optimization. After tiered_compilation_threshold launches,
+  // a background thread recompiles them with full optimization, and later
+  // launches use the optimized version once it is ready.
+  bool tiered_compilation;
+  int tiered_compilation_threshold;
   bool print_struct_llvm_ir;
   bool print_kernel_llvm_ir;
   bool print_kernel_llvm_ir_optimized;
@@ -17,6 +17,13 @@ struct Context {
   uint64 args[taichi_max_num_args];
   int32 extra_args[taichi_max_num_args][taichi_max_num_indices];
   int32 cpu_thread_id;
+  // Index of the kernel launch, for counter-based random numbers
+  uint32 rand_launch_id;
+  // Launch parameters of CPU tasks chosen by the autotuner (see
+  // CPUAutotuner). 0 keeps the ones the task was compiled with.
+  int32 cpu_block_dim;
+  int32 cpu_element_split;
+  int32 cpu_num_threads;
 
   static constexpr size_t extra_args_size = sizeof(extra_args);
 
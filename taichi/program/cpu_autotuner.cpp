@@ -0,0 +1,177 @@
+#include "taichi/program/cpu_autotuner.h"
+
+#include "taichi/ir/ir.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/system/timer.h"
+#include "taichi/util/statistics.h"
+
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+TLANG_NAMESPACE_BEGIN
+
+CPUAutotuner::CPUAutotuner(int trials) : trials_(std::max(trials, 1)) {
+}
+
+std::string CPUAutotuner::get_task_key(const std::string &kernel_name,
+                                       int task_id,
+                                       TaskKind kind,
+                                       IRNode *task_ir) {
+  // Python names kernels {func}_c{counter}_{instance} (see kernel.py), where
+  // the counter depends on how many kernels were defined before. Drop it.
+  static const std::regex python_kernel_name("(.*)_c\\d+_(\\d+(_grad)?)");
+  auto name = std::regex_replace(kernel_name, python_kernel_name, "$1_$2");
+  // Statement ids depend on what was compiled before. Renumber them, as
+  // IRBank does for its hashes.
+  std::string serialized;
+  irpass::re_id(task_ir);
+  irpass::print(task_ir, &serialized);
+  uint64 hash = 0;
+  for (auto c : serialized)
+    hash = hash * 100000007UL + (uint64)c;
+  return fmt::format("{}/{}/{}/{:016x}", name, task_id,
+                     kind == TaskKind::range_for ? "range_for" : "struct_for",
+                     hash);
+}
+
+std::vector<CPUAutotuner::Choice> CPUAutotuner::get_candidates(
+    TaskKind kind,
+    int num_threads) {
+  // Fewer threads can win on memory-bound tasks
+  std::vector<int> thread_counts = {0};
+  if (num_threads >= 4)
+    thread_counts.push_back(num_threads / 2);
+  std::vector<Choice> candidates;
+  for (auto n : thread_counts) {
+    if (kind == TaskKind::range_for) {
+      // 0 is the adaptive block_dim of cpu_parallel_range_for
+      for (int block_dim : {0, 32, 128, 512, 2048}) {
+        candidates.push_back({block_dim, 0, n});
+      }
+    } else {
+      for (int element_split : {1, 2, 4, 8}) {
+        candidates.push_back({0, element_split, n});
+      }
+    }
+  }
+  return candidates;
+}
+
+void CPUAutotuner::launch(const std::string &task_key,
+                          TaskKind kind,
+                          int num_threads,
+                          Context *context,
+                          const std::function<void()> &func) {
+  Record *record;
+  Choice choice;
+  int candidate_id = -1;
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    record = &records_[task_key];
+    if (!record->settled && record->candidates.empty()) {
+      record->candidates = get_candidates(kind, num_threads);
+      record->best_times.resize(record->candidates.size(), 1e30);
+    }
+    if (record->settled) {
+      choice = record->choice;
+    } else {
+      candidate_id = record->num_launches++ % (int)record->candidates.size();
+      choice = record->candidates[candidate_id];
+    }
+  }
+
+  context->cpu_block_dim = choice.block_dim;
+  context->cpu_element_split = choice.element_split;
+  context->cpu_num_threads = choice.num_threads;
+  auto start = Time::get_time();
+  func();
+  auto elapsed = Time::get_time() - start;
+  context->cpu_block_dim = 0;
+  context->cpu_element_split = 0;
+  context->cpu_num_threads = 0;
+
+  if (candidate_id == -1)
+    return;
+  stat.add("cpu_autotune_trial_launches");
+  std::lock_guard<std::mutex> _(mut_);
+  if (record->settled)
+    return;
+  auto &best_time = record->best_times[candidate_id];
+  best_time = std::min(best_time, elapsed);
+  int num_trials = trials_ * (int)record->candidates.size();
+  if (record->num_launches >= num_trials) {
+    int best = 0;
+    for (int i = 1; i < (int)record->best_times.size(); i++) {
+      if (record->best_times[i] < record->best_times[best])
+        best = i;
+    }
+    record->choice = record->candidates[best];
+    record->settled = true;
+    TI_TRACE("Autotuned {}: block_dim={} element_split={} num_threads={}",
+             task_key, record->choice.block_dim, record->choice.element_split,
+             record->choice.num_threads);
+  }
+}
+
+const CPUAutotuner::Choice *CPUAutotuner::get_choice(
+    const std::string &task_key) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto it = records_.find(task_key);
+  if (it == records_.end() || !it->second.settled)
+    return nullptr;
+  return &it->second.choice;
+}
+
+void CPUAutotuner::load(const std::string &filename) {
+  std::ifstream ifs(filename);
+  if (!ifs)
+    return;
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  auto content = ss.str();
+  // Only the format written by save() is accepted.
+  std::regex entry(
+      "\"([^\"]+)\"\\s*:\\s*\\{\\s*"
+      "\"block_dim\"\\s*:\\s*(\\d+)\\s*,\\s*"
+      "\"element_split\"\\s*:\\s*(\\d+)\\s*,\\s*"
+      "\"num_threads\"\\s*:\\s*(\\d+)\\s*\\}");
+  std::lock_guard<std::mutex> _(mut_);
+  int num_loaded = 0;
+  for (auto it = std::sregex_iterator(content.begin(), content.end(), entry);
+       it != std::sregex_iterator(); ++it) {
+    auto &match = *it;
+    auto &record = records_[match[1].str()];
+    record.choice.block_dim = std::stoi(match[2].str());
+    record.choice.element_split = std::stoi(match[3].str());
+    record.choice.num_threads = std::stoi(match[4].str());
+    record.settled = true;
+    num_loaded++;
+  }
+  TI_TRACE("Loaded {} autotuned task(s) from {}", num_loaded, filename);
+}
+
+void CPUAutotuner::save(const std::string &filename) {
+  std::lock_guard<std::mutex> _(mut_);
+  std::ofstream ofs(filename);
+  if (!ofs) {
+    TI_WARN("Failed to save autotuned launch parameters to {}", filename);
+    return;
+  }
+  ofs << "{";
+  bool first = true;
+  for (auto &[name, record] : records_) {
+    if (!record.settled)
+      continue;
+    ofs << (first ? "\n" : ",\n");
+    first = false;
+    ofs << fmt::format(
+        "  \"{}\": {{\"block_dim\": {}, \"element_split\": {}, "
+        "\"num_threads\": {}}}",
+        name, record.choice.block_dim, record.choice.element_split,
+        record.choice.num_threads);
+  }
+  ofs << "\n}\n";
+}
+
+TLANG_NAMESPACE_END
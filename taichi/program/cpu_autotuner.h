@@ -0,0 +1,78 @@
+#pragma once
+
+#include "taichi/lang_util.h"
+#define TI_RUNTIME_HOST
+#include "taichi/program/context.h"
+#undef TI_RUNTIME_HOST
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+TLANG_NAMESPACE_BEGIN
+
+class IRNode;
+
+// Tunes the launch parameters of CPU offloaded tasks online. The first
+// |trials| x (number of candidates) launches of each task cycle through a
+// fixed set of candidate parameters and are timed; later launches use the
+// fastest candidate. Tasks are identified by keys that stay the same across
+// runs and compilations (see get_task_key), so that choices can be saved and
+// reused by later runs of the same program.
+class CPUAutotuner {
+ public:
+  enum class TaskKind { range_for, struct_for };
+
+  // A value of 0 keeps the parameter the task was compiled with. The runtime
+  // never uses more threads than the task was compiled for.
+  struct Choice {
+    int block_dim{0};
+    int element_split{0};
+    int num_threads{0};
+  };
+
+  explicit CPUAutotuner(int trials);
+
+  // Identifies task |task_id| of a kernel by the kernel name, the index of the
+  // task, its kind and a hash of its IR |task_ir|. Python kernels of the same
+  // name, e.g. from different modules, only share a key if their tasks are
+  // the same.
+  static std::string get_task_key(const std::string &kernel_name,
+                                  int task_id,
+                                  TaskKind kind,
+                                  IRNode *task_ir);
+
+  // |num_threads| is the thread count the task was compiled with.
+  void launch(const std::string &task_key,
+              TaskKind kind,
+              int num_threads,
+              Context *context,
+              const std::function<void()> &func);
+
+  // Returns the choice a task has settled on, or nullptr if it is still being
+  // tuned.
+  const Choice *get_choice(const std::string &task_key);
+
+  void load(const std::string &filename);
+
+  void save(const std::string &filename);
+
+ private:
+  struct Record {
+    std::vector<Choice> candidates;
+    std::vector<double> best_times;
+    int num_launches{0};
+    bool settled{false};
+    Choice choice;
+  };
+
+  static std::vector<Choice> get_candidates(TaskKind kind, int num_threads);
+
+  int trials_;
+  std::unordered_map<std::string, Record> records_;
+  std::mutex mut_;
+};
+
+TLANG_NAMESPACE_END
@@ -68,6 +68,29 @@ Kernel::Kernel(Program &program,
 void Kernel::compile() {
   CurrentKernelGuard _(program, this);
   compiled = program.compile(*this);
+  fast_compiled = program.uses_tiered_compilation(*this);
+  num_fast_launches = 0;
+  optimized = nullptr;
+}
+
+void Kernel::update_tier() {
+  if (optimized && optimized->ready()) {
+    // Only this thread launches the kernel, so swapping |compiled| here is
+    // safe.
+    if (auto func = optimized->get()) {
+      compiled = func;
+      stat.add("tiered_compilation_upgrades");
+    }
+    // If recompiling failed, keep the first tier for good
+    optimized = nullptr;
+    fast_compiled = false;
+    return;
+  }
+  ++num_fast_launches;
+  if (!optimized &&
+      num_fast_launches >= program.config.tiered_compilation_threshold) {
+    optimized = program.recompile_optimized(*this);
+  }
 }
 
 void Kernel::lower(bool to_executable) {  // TODO: is a "Lowerer" class
@@ -106,6 +129,9 @@ void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
       compile();
     }
 
+    if (fast_compiled)
+      update_tier();
+
     for (auto &offloaded : ir->as<Block>()->statements) {
       account_for_offloaded(offloaded->as<OffloadedStmt>());
     }
@@ -249,6 +275,10 @@ void Kernel::LaunchContextBuilder::set_arg_raw(int i, uint64 d) {
 
 Context &Kernel::LaunchContextBuilder::get_context() {
   ctx_->runtime = static_cast<LLVMRuntime *>(kernel_->program.llvm_runtime);
+  ctx_->rand_launch_id = kernel_->program.num_rand_launches++;
+  ctx_->cpu_block_dim = 0;
+  ctx_->cpu_element_split = 0;
+  ctx_->cpu_num_threads = 0;
   return *ctx_;
 }
 
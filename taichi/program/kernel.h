@@ -11,6 +11,7 @@
 TLANG_NAMESPACE_BEGIN
 
 class Program;
+class AsyncCompiledFunc;
 
 class Kernel {
  public:
@@ -48,6 +49,12 @@ class Kernel {
   bool is_evaluator;
   bool grad;
 
+  // Tiered compilation: whether |compiled| is the first tier, the number of
+  // launches with it, and the optimized version once requested
+  bool fast_compiled{false};
+  int num_fast_launches{0};
+  std::shared_ptr<AsyncCompiledFunc> optimized;
+
   // TODO: Give "Context" a more specific name.
   class LaunchContextBuilder {
    public:
@@ -107,6 +114,11 @@ class Kernel {
   void set_arch(Arch arch);
 
   void account_for_offloaded(OffloadedStmt *stmt);
+
+ private:
+  // Switches to the optimized version of a tiered kernel once it is ready,
+  // and requests it once the kernel is hot.
+  void update_tier();
 };
 
 TLANG_NAMESPACE_END
@@ -19,6 +19,7 @@
 #include "taichi/backends/metal/struct_metal.h"
 #include "taichi/backends/opengl/struct_opengl.h"
 #include "taichi/system/unified_allocator.h"
+#include "taichi/system/virtual_memory.h"
 #include "taichi/system/timeline.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/frontend_ir.h"
@@ -56,6 +57,10 @@ void *taichi_allocate_aligned(Program *prog,
   return prog->memory_pool->allocate(size, alignment);
 }
 
+void taichi_decommit(Program *prog, void *ptr, std::size_t size) {
+  VirtualMemoryAllocator::decommit(ptr, size);
+}
+
 inline uint64 *allocate_result_buffer_default(Program *prog) {
   return (uint64 *)taichi_allocate_aligned(
       prog, sizeof(uint64) * taichi_result_buffer_entries, 8);
@@ -143,7 +148,10 @@ Program::Program(Arch desired_arch) {
   config = default_compile_config;
   config.arch = arch;
 
-  thread_pool = std::make_unique<ThreadPool>(config.cpu_max_num_threads);
+  thread_pool = std::make_unique<ThreadPool>(
+      config.cpu_max_num_threads,
+      /*work_stealing=*/config.cpu_work_stealing || config.cpu_numa,
+      /*pin_threads=*/config.cpu_numa);
 
   llvm_context_host = std::make_unique<TaichiLLVMContext>(host_arch());
   profiler = make_profiler(arch);
@@ -214,6 +222,28 @@ Program::Program(Arch desired_arch) {
 
   if (arch_is_cpu(arch)) {
     config.max_block_dim = 1024;
+    // Async tasks are fused and recompiled, and have no stable identity
+    if (!config.async_mode && config.cpu_autotune) {
+      cpu_autotuner =
+          std::make_unique<CPUAutotuner>(config.cpu_autotune_trials);
+      if (!config.cpu_autotune_file.empty())
+        cpu_autotuner->load(config.cpu_autotune_file);
+    }
+    if (config.kernel_cache) {
+      auto path = config.kernel_cache_path;
+      if (path.empty())
+        path = KernelCache::get_default_path();
+      kernel_cache = std::make_unique<KernelCache>(
+          path, (std::size_t)config.kernel_cache_max_size_MB << 20);
+    }
+    if (!config.async_mode && config.num_compile_threads > 1) {
+      compilation_workers = std::make_unique<ParallelExecutor>(
+          "compiler", config.num_compile_threads);
+    }
+    if (!config.async_mode && config.tiered_compilation) {
+      tiered_compilation_worker =
+          std::make_unique<ParallelExecutor>("tiered_compiler", 1);
+    }
   }
 
   stat.clear();
@@ -238,7 +268,9 @@ FunctionType Program::compile(Kernel &kernel) {
   if (arch_is_cpu(kernel.arch) || kernel.arch == Arch::cuda ||
       kernel.arch == Arch::metal) {
     kernel.lower();
-    ret = compile_to_backend_executable(kernel, /*offloaded=*/nullptr);
+    ret = compile_to_backend_executable(
+        kernel, /*offloaded=*/nullptr,
+        /*fast_compile=*/uses_tiered_compilation(kernel));
   } else if (kernel.arch == Arch::opengl) {
     opengl::OpenglCodeGen codegen(kernel.name, &opengl_struct_compiled_.value(),
                                   opengl_kernel_launcher_.get());
@@ -256,9 +288,11 @@ FunctionType Program::compile(Kernel &kernel) {
 }
 
 FunctionType Program::compile_to_backend_executable(Kernel &kernel,
-                                                    OffloadedStmt *offloaded) {
+                                                    OffloadedStmt *offloaded,
+                                                    bool fast_compile) {
   if (arch_is_cpu(kernel.arch) || kernel.arch == Arch::cuda) {
     auto codegen = KernelCodeGen::create(kernel.arch, &kernel, offloaded);
+    codegen->set_fast_compile(fast_compile);
     return codegen->compile();
   } else if (kernel.arch == Arch::metal) {
     return metal::compile_to_metal_executable(&kernel, metal_kernel_mgr_.get(),
@@ -269,6 +303,35 @@ FunctionType Program::compile_to_backend_executable(Kernel &kernel,
   return nullptr;
 }
 
+bool Program::uses_tiered_compilation(const Kernel &kernel) const {
+  // Accessors and evaluators are cheap to compile and not worth recompiling
+  return tiered_compilation_worker && arch_is_cpu(kernel.arch) &&
+         !kernel.is_accessor && !kernel.is_evaluator;
+}
+
+std::shared_ptr<AsyncCompiledFunc> Program::recompile_optimized(
+    Kernel &kernel) {
+  TI_ASSERT(tiered_compilation_worker);
+  auto optimized = std::make_shared<AsyncCompiledFunc>();
+  tiered_compilation_worker->enqueue([this, &kernel, optimized]() {
+    TI_TIMELINE(kernel.name);
+    FunctionType func;
+    try {
+      func = compile_to_backend_executable(kernel, /*offloaded=*/nullptr);
+    } catch (const std::exception &e) {
+      // Keep using the first tier
+      TI_WARN("Failed to recompile kernel {}: {}", kernel.name, e.what());
+    }
+    optimized->set(func);
+  });
+  return optimized;
+}
+
+void Program::wait_for_tiered_compilation() {
+  if (tiered_compilation_worker)
+    tiered_compilation_worker->flush();
+}
+
 // For CPU and CUDA archs only
 void Program::initialize_runtime_system(StructCompiler *scomp) {
   // auto tlctx = llvm_context_host.get();
@@ -347,6 +410,11 @@ void Program::initialize_runtime_system(StructCompiler *scomp) {
     memory_pool->set_queue((MemRequestQueue *)mem_req_queue);
   }
 
+  if (arch_is_cpu(config.arch) && config.gc_decommit) {
+    runtime->call<void *, void *>("runtime_set_host_decommit", llvm_runtime,
+                                  (void *)&taichi_decommit);
+  }
+
   runtime->call<void *, int, int>("runtime_initialize2", llvm_runtime, root_id,
                                   (int)snodes.size());
 
@@ -354,18 +422,35 @@ void Program::initialize_runtime_system(StructCompiler *scomp) {
     if (is_gc_able(snodes[i]->type)) {
       std::size_t node_size;
       auto element_size = snodes[i]->cell_size_bytes;
-      if (snodes[i]->type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
+      if (snodes[i]->type == SNodeType::pointer ||
+          snodes[i]->type == SNodeType::hash) {
+        // pointer and hash. Allocators are for single elements
         node_size = element_size;
       } else {
         // dynamic. Allocators are for the chunks
-        node_size = sizeof(void *) + element_size * snodes[i]->chunk_size;
+        node_size = element_size * snodes[i]->chunk_size;
+      }
+      // Magazines are indexed by the CPU thread id
+      int num_magazines = 0;
+      if (arch_is_cpu(config.arch) && config.cpu_alloc_magazines) {
+        num_magazines = config.cpu_max_num_threads;
       }
       TI_TRACE("Initializing allocator for snode {} (node size {})",
                snodes[i]->id, node_size);
       auto rt = llvm_runtime;
-      runtime->call<void *, int, std::size_t>(
-          "runtime_NodeAllocator_initialize", rt, snodes[i]->id, node_size);
+      runtime->call<void *, int, std::size_t, int>(
+          "runtime_NodeAllocator_initialize", rt, snodes[i]->id, node_size,
+          num_magazines);
+      if (snodes[i]->type == SNodeType::dynamic &&
+          snodes[i]->dynamic_log2_page_size() >= 0) {
+        runtime->call<void *, int, std::size_t>(
+            "runtime_DynamicDirectoryAllocator_initialize", rt, snodes[i]->id,
+            sizeof(void *) << snodes[i]->dynamic_log2_page_size());
+      }
+      if (snodes[i]->type == SNodeType::hash) {
+        runtime->call<void *, int>("runtime_HashDirtyTables_initialize", rt,
+                                   snodes[i]->id);
+      }
       TI_TRACE("Allocating ambient element for snode {} (node size {})",
                snodes[i]->id, node_size);
       runtime->call<void *, int>("runtime_allocate_ambient", rt, i, node_size);
@@ -700,6 +785,9 @@ void Program::finalize() {
   if (async_engine)
     async_engine = nullptr;  // Finalize the async engine threads before
                              // anything else gets destoried.
+  // Wait for background compilation before the kernels are destroyed
+  tiered_compilation_worker = nullptr;
+  compilation_workers = nullptr;
   TI_TRACE("Program finalizing...");
   if (config.print_benchmark_stat) {
     const char *current_test = std::getenv("PYTEST_CURRENT_TEST");
@@ -737,6 +825,8 @@ void Program::finalize() {
   if (runtime)
     runtime->set_profiler(nullptr);
   synchronize();
+  if (cpu_autotuner && !config.cpu_autotune_file.empty())
+    cpu_autotuner->save(config.cpu_autotune_file);
   current_program = nullptr;
   memory_pool->terminate();
 #if defined(TI_WITH_CUDA)
@@ -758,7 +848,7 @@ int Program::default_block_dim() const {
 
 void Program::print_list_manager_info(void *list_manager) {
   auto list_manager_len =
-      runtime_query<int32>("ListManager_get_num_elements", list_manager);
+      runtime_query<int64>("ListManager_get_num_elements", list_manager);
 
   auto element_size =
       runtime_query<int32>("ListManager_get_element_size", list_manager);
@@ -808,12 +898,12 @@ void Program::print_memory_profiler_info() {
               "NodeManager_get_recycled_list", node_allocator);
 
           auto free_list_len =
-              runtime_query<int32>("ListManager_get_num_elements", free_list);
+              runtime_query<int64>("ListManager_get_num_elements", free_list);
 
-          auto recycled_list_len = runtime_query<int32>(
+          auto recycled_list_len = runtime_query<int64>(
               "ListManager_get_num_elements", recycled_list);
 
-          auto free_list_used = runtime_query<int32>(
+          auto free_list_used = runtime_query<int64>(
               "NodeManager_get_free_list_used", node_allocator);
 
           auto data_list = runtime_query<void *>("NodeManager_get_data_list",
@@ -849,10 +939,21 @@ std::size_t Program::get_snode_num_dynamically_allocated(SNode *snode) {
   auto data_list =
       runtime_query<void *>("NodeManager_get_data_list", node_allocator);
 
-  return (std::size_t)runtime_query<int32>("ListManager_get_num_elements",
+  return (std::size_t)runtime_query<int64>("ListManager_get_num_elements",
                                            data_list);
 }
 
+std::size_t Program::get_reserved_memory_bytes() {
+  return (std::size_t)runtime_query<int64>(
+      "LLVMRuntime_get_total_requested_memory", llvm_runtime);
+}
+
+std::size_t Program::get_committed_memory_bytes() {
+  return get_reserved_memory_bytes() -
+         (std::size_t)runtime_query<int64>(
+             "LLVMRuntime_get_total_decommitted_memory", llvm_runtime);
+}
+
 Program::~Program() {
   if (!finalized)
     finalize();
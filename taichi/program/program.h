@@ -15,6 +15,8 @@
 #include "taichi/backends/metal/kernel_manager.h"
 #include "taichi/backends/opengl/opengl_kernel_launcher.h"
 #include "taichi/backends/cc/cc_program.h"
+#include "taichi/jit/kernel_cache.h"
+#include "taichi/program/cpu_autotuner.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/kernel_profiler.h"
 #include "taichi/program/context.h"
@@ -75,6 +77,8 @@ TI_FORCE_INLINE Program &get_current_program() {
 class StructCompiler;
 
 class AsyncEngine;
+class ParallelExecutor;
+class AsyncCompiledFunc;
 
 class Program {
  public:
@@ -85,6 +89,9 @@ class Program {
   CompileConfig config;
   std::unique_ptr<TaichiLLVMContext> llvm_context_host, llvm_context_device;
   bool sync;  // device/host synchronized?
+  // Number of kernel launches so far. Makes counter-based random numbers
+  // differ between launches.
+  uint32 num_rand_launches{0};
   bool finalized;
   float64 total_compilation_time;
   static std::atomic<int> num_instances;
@@ -101,6 +108,19 @@ class Program {
 
   std::unique_ptr<KernelProfilerBase> profiler;
 
+  // Only set on CPUs with config.cpu_autotune
+  std::unique_ptr<CPUAutotuner> cpu_autotuner;
+
+  // Only set on CPUs with config.kernel_cache
+  std::unique_ptr<KernelCache> kernel_cache;
+
+  // Compiles the offloaded tasks of CPU kernels concurrently in sync mode.
+  // Only set with config.num_compile_threads > 1.
+  std::unique_ptr<ParallelExecutor> compilation_workers;
+
+  // Only set with config.tiered_compilation
+  std::unique_ptr<ParallelExecutor> tiered_compilation_worker;
+
   std::unordered_map<JITEvaluatorId, std::unique_ptr<Kernel>>
       jit_evaluator_cache;
   std::mutex jit_evaluator_cache_mut;
@@ -193,7 +213,19 @@ class Program {
 
   // Just does the per-backend executable compilation without kernel lowering.
   FunctionType compile_to_backend_executable(Kernel &kernel,
-                                             OffloadedStmt *stmt);
+                                             OffloadedStmt *stmt,
+                                             bool fast_compile = false);
+
+  // Whether |kernel| is compiled in two tiers (see
+  // CompileConfig::tiered_compilation)
+  bool uses_tiered_compilation(const Kernel &kernel) const;
+
+  // Compiles the lowered |kernel| with full optimization on
+  // |tiered_compilation_worker|.
+  std::shared_ptr<AsyncCompiledFunc> recompile_optimized(Kernel &kernel);
+
+  // Blocks until all requested optimized recompilations are done
+  void wait_for_tiered_compilation();
 
   void initialize_runtime_system(StructCompiler *scomp);
 
@@ -273,6 +305,13 @@ class Program {
   // Returns zero if the SNode is statically allocated
   std::size_t get_snode_num_dynamically_allocated(SNode *snode);
 
+  // Bytes of memory requested by the LLVM runtime, including memory
+  // decommitted by GC (see CompileConfig::gc_decommit)
+  std::size_t get_reserved_memory_bytes();
+
+  // Same as get_reserved_memory_bytes(), excluding decommitted memory
+  std::size_t get_committed_memory_bytes();
+
   ~Program();
 
  private:
@@ -122,6 +122,19 @@ void export_lang(py::module &m) {
       .def_readwrite("use_llvm", &CompileConfig::use_llvm)
       .def_readwrite("print_benchmark_stat",
                      &CompileConfig::print_benchmark_stat)
+      .def_readwrite("kernel_cache", &CompileConfig::kernel_cache)
+      .def_readwrite("kernel_cache_path", &CompileConfig::kernel_cache_path)
+      .def_readwrite("kernel_cache_max_size_MB",
+                     &CompileConfig::kernel_cache_max_size_MB)
+      .def_readwrite("num_compile_threads",
+                     &CompileConfig::num_compile_threads)
+      .def_readwrite("cpu_target", &CompileConfig::cpu_target)
+      .def_readwrite("cpu_features", &CompileConfig::cpu_features)
+      .def_readwrite("cpu_multiversioning_target",
+                     &CompileConfig::cpu_multiversioning_target)
+      .def_readwrite("tiered_compilation", &CompileConfig::tiered_compilation)
+      .def_readwrite("tiered_compilation_threshold",
+                     &CompileConfig::tiered_compilation_threshold)
       .def_readwrite("print_struct_llvm_ir",
                      &CompileConfig::print_struct_llvm_ir)
       .def_readwrite("print_kernel_llvm_ir",
@@ -142,6 +155,18 @@ void export_lang(py::module &m) {
       .def_readwrite("saturating_grid_dim", &CompileConfig::saturating_grid_dim)
       .def_readwrite("max_block_dim", &CompileConfig::max_block_dim)
       .def_readwrite("cpu_max_num_threads", &CompileConfig::cpu_max_num_threads)
+      .def_readwrite("cpu_work_stealing", &CompileConfig::cpu_work_stealing)
+      .def_readwrite("cpu_alloc_magazines",
+                     &CompileConfig::cpu_alloc_magazines)
+      .def_readwrite("cpu_numa", &CompileConfig::cpu_numa)
+      .def_readwrite("cpu_numa_memory_policy",
+                     &CompileConfig::cpu_numa_memory_policy)
+      .def_readwrite("cpu_huge_pages", &CompileConfig::cpu_huge_pages)
+      .def_readwrite("cpu_autotune", &CompileConfig::cpu_autotune)
+      .def_readwrite("cpu_autotune_trials",
+                     &CompileConfig::cpu_autotune_trials)
+      .def_readwrite("cpu_autotune_file", &CompileConfig::cpu_autotune_file)
+      .def_readwrite("cpu_simd_width", &CompileConfig::cpu_simd_width)
       .def_readwrite("verbose_kernel_launches",
                      &CompileConfig::verbose_kernel_launches)
       .def_readwrite("verbose", &CompileConfig::verbose)
@@ -159,6 +184,11 @@ void export_lang(py::module &m) {
       .def_readwrite("advanced_optimization",
                      &CompileConfig::advanced_optimization)
       .def_readwrite("ad_stack_size", &CompileConfig::ad_stack_size)
+      .def_readwrite("random_counter_based",
+                     &CompileConfig::random_counter_based)
+      .def_readwrite("random_seed", &CompileConfig::random_seed)
+      .def_readwrite("gc_zero_fill", &CompileConfig::gc_zero_fill)
+      .def_readwrite("gc_decommit", &CompileConfig::gc_decommit)
       .def_readwrite("async_mode", &CompileConfig::async_mode)
       .def_readwrite("flatten_if", &CompileConfig::flatten_if)
       .def_readwrite("make_thread_local", &CompileConfig::make_thread_local)
@@ -213,6 +243,22 @@ void export_lang(py::module &m) {
       .def("print_snode_tree", &Program::print_snode_tree)
       .def("get_snode_num_dynamically_allocated",
            &Program::get_snode_num_dynamically_allocated)
+      .def("get_reserved_memory_bytes", &Program::get_reserved_memory_bytes)
+      .def("get_committed_memory_bytes", &Program::get_committed_memory_bytes)
+      .def("get_kernel_cache_hits",
+           [](Program *program) -> int64 {
+             if (!program->kernel_cache)
+               return 0;
+             return program->kernel_cache->get_stats().hits;
+           })
+      .def("get_kernel_cache_misses",
+           [](Program *program) -> int64 {
+             if (!program->kernel_cache)
+               return 0;
+             return program->kernel_cache->get_stats().misses;
+           })
+      .def("wait_for_tiered_compilation",
+           &Program::wait_for_tiered_compilation)
       .def("benchmark_rebuild_graph",
            [](Program *program) {
              program->async_engine->sfg->benchmark_rebuild_graph();
@@ -243,9 +289,10 @@ void export_lang(py::module &m) {
            py::return_value_policy::reference)
       .def("hash",
            (SNode & (SNode::*)(const std::vector<Index> &,
-                               const std::vector<int> &))(&SNode::hash),
+                               const std::vector<int> &, int))(&SNode::hash),
            py::return_value_policy::reference)
       .def("dynamic", &SNode::dynamic, py::return_value_policy::reference)
+      .def("morton", &SNode::morton, py::return_value_policy::reference)
       .def("bitmasked",
            (SNode & (SNode::*)(const std::vector<Index> &,
                                const std::vector<int> &))(&SNode::bitmasked),
@@ -21,11 +21,23 @@ i32 refresh_counter(Context *context) {
 }
 
 i32 test_stack(Context *context) {
-  auto stack = new u8[132];
-  stack_push(stack, 16, 4);
-  stack_push(stack, 16, 4);
-  stack_push(stack, 16, 4);
-  stack_push(stack, 16, 4);
+  auto runtime = context->runtime;
+  // Four inline entries; the rest spill to heap chunks.
+  auto stack = new u8[taichi_ad_stack_header_size + 4 * 2 * 4];
+  stack_init(stack);
+  const int n = 2000;
+  for (int i = 0; i < n; i++) {
+    stack_push(runtime, stack, 4, 4);
+    *(i32 *)stack_top_primal(stack, 4, 4) = i;
+    *(i32 *)stack_top_adjoint(stack, 4, 4) = -i;
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    TI_TEST_CHECK(*(i32 *)stack_top_primal(stack, 4, 4) == i, runtime);
+    TI_TEST_CHECK(*(i32 *)stack_top_adjoint(stack, 4, 4) == -i, runtime);
+    stack_pop(runtime, stack, 4, 4);
+  }
+  TI_TEST_CHECK(((ADStackHeader *)stack)->spill_top == nullptr, runtime);
+  delete[] stack;
   return 0;
 }
 
@@ -44,6 +56,24 @@ i32 test_list_manager(Context *context) {
   return 0;
 }
 
+i32 test_list_manager_i64(Context *context) {
+  auto runtime = context->runtime;
+  auto list = context->runtime->create<ListManager>(runtime, 4, 1 << 16);
+  // Only the touched chunks are allocated.
+  const i64 n = (1LL << 32) + 16;
+  list->resize(n);
+  TI_TEST_CHECK(list->size() == n, runtime);
+  for (i64 i = n - 16; i < n; i++) {
+    *(i32 *)list->touch_and_get(i) = (i32)(i - (1LL << 32));
+  }
+  *(i32 *)list->touch_and_get(0) = -1;
+  for (i64 i = n - 16; i < n; i++) {
+    TI_TEST_CHECK(list->get<i32>(i) == i - (1LL << 32), runtime);
+  }
+  TI_TEST_CHECK(list->get<i32>(0) == -1, runtime);
+  return 0;
+}
+
 i32 test_node_allocator(Context *context) {
   auto runtime = context->runtime;
   taichi_printf(runtime, "LLVMRuntime %p\n", runtime);
@@ -65,14 +95,15 @@ i32 test_node_allocator(Context *context) {
     ptrs[i] = nodes->allocate();
   }
   for (int i = 5; i < 19; i++) {
-    TI_TEST_CHECK(nodes->locate(ptrs[i]) == i, runtime);
+    TI_TEST_CHECK(ptrs[i] == nodes->data_list->get_element_ptr(i), runtime);
   }
 
   for (int i = 19; i < 24; i++) {
-    auto idx = nodes->locate(ptrs[i]);
     taichi_printf(runtime, "i %d", i);
-    taichi_printf(runtime, "idx %d", idx);
-    TI_TEST_CHECK(idx == i - 19, runtime);
+    taichi_printf(runtime, "ptr %p", ptrs[i]);
+    // Recycled nodes are reused in order
+    TI_TEST_CHECK(ptrs[i] == nodes->data_list->get_element_ptr(i - 19),
+                  runtime);
   }
   return 0;
 }
@@ -115,7 +146,7 @@ i32 test_node_allocator_gc_cpu(Context *context) {
   }
   nodes->gc_serial();
   // After GC, all items should be returned to |free_list|.
-  taichi_printf(runtime, "free_list_size=%d\n", nodes->free_list->size());
+  taichi_printf(runtime, "free_list_size=%lld\n", nodes->free_list->size());
   TI_TEST_CHECK(nodes->free_list->size() == kN, runtime);
 
   return 0;
@@ -29,6 +29,31 @@ void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
   atomic_and_u32(&mask_begin[i / 32], ~(1UL << (i % 32)));
 }
 
+i32 Bitmasked_find_next_slot(Ptr meta,
+                             Ptr node,
+                             int begin,
+                             int end,
+                             i32 active) {
+  if (begin >= end)
+    return end;
+  auto smeta = (StructMeta *)meta;
+  auto element_size = StructMeta_get_element_size(smeta);
+  auto num_elements = Bitmasked_get_num_elements(meta, node);
+  auto data_section_size = element_size * num_elements;
+  auto mask_begin = (u32 *)(node + data_section_size);
+  // Search for set bits in (possibly inverted) mask words
+  u32 flip = active ? 0 : ~0u;
+  int w = begin / 32;
+  u32 word = (mask_begin[w] ^ flip) & (~0u << (begin % 32));
+  while (word == 0) {
+    w++;
+    if (w * 32 >= end)
+      return end;
+    word = mask_begin[w] ^ flip;
+  }
+  return min_i32(w * 32 + cttz_i32(word), end);
+}
+
 i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
   auto smeta = (StructMeta *)meta;
   auto element_size = StructMeta_get_element_size(smeta);
@@ -1,5 +1,15 @@
 #pragma once
 
+// The chunks of a dynamic node are indexed by a two-level directory, so that
+// both appending and random access take O(1) time: |DynamicNode::ptr| points
+// to a page of page pointers, each of which points to a page of chunk
+// pointers. Both levels hold 2^log2_page_size pointers
+// (see SNode::dynamic_log2_page_size). A node with a single chunk has no
+// directory, and |ptr| points to the chunk itself.
+//
+// Directory pages are allocated on first use and stay with the node;
+// deactivation only recycles the chunks. All chunks containing an element
+// below |n| are allocated.
 struct DynamicNode {
   i32 lock;
   i32 n;
@@ -9,34 +19,72 @@ struct DynamicNode {
 // Specialized Attributes and functions
 struct DynamicMeta : public StructMeta {
   int chunk_size;
+  int log2_page_size;
 };
 
 STRUCT_FIELD(DynamicMeta, chunk_size);
+STRUCT_FIELD(DynamicMeta, log2_page_size);
+
+// Returns the directory entry of chunk |c|, or nullptr if the page holding it
+// does not exist.
+Ptr *Dynamic_find_chunk_entry(DynamicMeta *meta, DynamicNode *node, int c) {
+  if (meta->log2_page_size < 0)
+    return &node->ptr;
+  auto root = *(Ptr *volatile *)&node->ptr;
+  if (root == nullptr)
+    return nullptr;
+  auto page = *(Ptr *volatile *)&((Ptr *)root)[c >> meta->log2_page_size];
+  if (page == nullptr)
+    return nullptr;
+  return (Ptr *)page + (c & ((1 << meta->log2_page_size) - 1));
+}
+
+Ptr Dynamic_allocate_directory_page(DynamicMeta *meta) {
+  auto rt = meta->context->runtime;
+  // Directory pages are never recycled, so they are always zero-filled.
+  return rt->dynamic_directory_allocators[meta->snode_id]->allocate();
+}
+
+// Makes sure that chunk |c| is allocated.
+void Dynamic_allocate_chunk(DynamicMeta *meta, DynamicNode *node, int c) {
+  auto entry = Dynamic_find_chunk_entry(meta, node, c);
+  if (entry != nullptr && *(Ptr volatile *)entry != nullptr)
+    return;
+  locked_task(Ptr(&node->lock), [&] {
+    if (meta->log2_page_size >= 0) {
+      if (node->ptr == nullptr) {
+        atomic_exchange_u64((u64 *)&node->ptr,
+                            (u64)Dynamic_allocate_directory_page(meta));
+      }
+      auto &page = ((Ptr *)node->ptr)[c >> meta->log2_page_size];
+      if (page == nullptr) {
+        atomic_exchange_u64((u64 *)&page,
+                            (u64)Dynamic_allocate_directory_page(meta));
+      }
+    }
+    entry = Dynamic_find_chunk_entry(meta, node, c);
+    if (*entry == nullptr) {
+      auto rt = meta->context->runtime;
+      auto alloc = rt->node_allocators[meta->snode_id];
+      auto chunk = alloc->allocate_thread_local(meta->context->cpu_thread_id);
+      atomic_exchange_u64((u64 *)entry, (u64)chunk);
+    }
+  });
+}
 
 void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
-  // We need to not only update node->n, but also make sure the chunk containing
-  // element i is allocated.
-  atomic_max_i32(&node->n, i + 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
   auto chunk_size = meta->chunk_size;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      return;
-    }
-    p_chunk_ptr = (Ptr *)*p_chunk_ptr;
-    chunk_start += chunk_size;
+  // We need to not only update node->n, but also make sure the chunks
+  // containing elements [old n, i] are allocated.
+  i32 n = *(volatile i32 *)&node->n;
+  if (n <= i)
+    n = atomic_max_i32(&node->n, i + 1);
+  auto last_chunk = i / chunk_size;
+  for (int c = min_i32((n + chunk_size - 1) / chunk_size, last_chunk);
+       c <= last_chunk; c++) {
+    Dynamic_allocate_chunk(meta, node, c);
   }
 }
 
@@ -45,15 +93,17 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
   auto node = (DynamicNode *)(node_);
   if (node->n > 0) {
     locked_task(Ptr(&node->lock), [&] {
-      node->n = 0;
-      auto p_chunk_ptr = &node->ptr;
       auto rt = meta->context->runtime;
       auto alloc = rt->node_allocators[meta->snode_id];
-      while (*p_chunk_ptr) {
-        alloc->recycle(*p_chunk_ptr);
-        p_chunk_ptr = (Ptr *)*p_chunk_ptr;
+      auto num_chunks = (node->n + meta->chunk_size - 1) / meta->chunk_size;
+      for (int c = 0; c < num_chunks; c++) {
+        auto entry = Dynamic_find_chunk_entry(meta, node, c);
+        if (entry != nullptr && *entry != nullptr) {
+          alloc->recycle(*entry);
+          *entry = nullptr;
+        }
       }
-      node->ptr = nullptr;
+      node->n = 0;
     });
   }
 }
@@ -63,26 +113,10 @@ i32 Dynamic_append(Ptr meta_, Ptr node_, i32 data) {
   auto node = (DynamicNode *)(node_);
   auto chunk_size = meta->chunk_size;
   auto i = atomic_add_i32(&node->n, 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      *(i32 *)(*p_chunk_ptr + sizeof(Ptr) +
-               (i - chunk_start) * meta->element_size) = data;
-      break;
-    }
-    p_chunk_ptr = (Ptr *)(*p_chunk_ptr);
-    chunk_start += chunk_size;
-  }
+  auto c = i / chunk_size;
+  Dynamic_allocate_chunk(meta, node, c);
+  auto chunk = *Dynamic_find_chunk_entry(meta, node, c);
+  *(i32 *)(chunk + (i - c * chunk_size) * meta->element_size) = data;
   return i;
 }
 
@@ -95,21 +129,12 @@ Ptr Dynamic_lookup_element(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   if (Dynamic_is_active(meta_, node_, i)) {
-    int chunk_start = 0;
-    auto chunk_ptr = node->ptr;
-    auto chunk_size = meta->chunk_size;
-    while (true) {
-      if (i < chunk_start + chunk_size) {
-        auto addr =
-            chunk_ptr + sizeof(Ptr) + (i - chunk_start) * meta->element_size;
-        return addr;
-      }
-      chunk_ptr = *(Ptr *)chunk_ptr;
-      chunk_start += chunk_size;
-    }
-  } else {
-    return (meta->context->runtime)->ambient_elements[meta->snode_id];
+    auto c = i / meta->chunk_size;
+    auto entry = Dynamic_find_chunk_entry(meta, node, c);
+    if (entry != nullptr && *entry != nullptr)
+      return *entry + (i - c * meta->chunk_size) * meta->element_size;
   }
+  return (meta->context->runtime)->ambient_elements[meta->snode_id];
 }
 
 i32 Dynamic_get_num_elements(Ptr meta_, Ptr node_) {
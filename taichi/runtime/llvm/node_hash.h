@@ -0,0 +1,241 @@
+#pragma once
+
+// A hash node stores its active cells in an open-addressing table of
+// |capacity| slots, so that the index space (max_num_elements) can be far
+// larger than the memory reserved for the node.
+//
+// Node layout (see StructCompilerLLVM::generate_types):
+//   i64 num_tombstones, [capacity x {i32 key, i32 lock}], [capacity x Ptr data]
+// A key stores (element index + 1), so that a zero-filled node is an empty
+// table. Deactivation recycles the data of the slot and turns its key into a
+// tombstone, which later insertions of any key may claim. Lookups probe past
+// tombstones and stop at the first empty slot. Insertions of new keys are
+// serialized by the lock of the key's initial slot, so that two threads
+// inserting the same key cannot claim two different slots.
+//
+// Tombstones only turn back into empty slots when the table is rebuilt, which
+// needs exclusive access. Once a table has collected capacity / 8 tombstones,
+// deactivation queues it in LLVMRuntime::hash_dirty_tables, and the GC task
+// that follows every deactivating task rebuilds it (see Hash_gc). Without
+// this, a moving window of keys would eventually leave no empty slot, and
+// every miss would probe the whole table.
+
+// Specialized Attributes and functions
+struct HashMeta : public StructMeta {
+  i32 capacity;
+};
+
+STRUCT_FIELD(HashMeta, capacity);
+
+constexpr i32 taichi_hash_tombstone = -1;
+
+i64 *Hash_get_num_tombstones_ptr(Ptr node) {
+  return (i64 *)node;
+}
+
+i32 Hash_get_num_elements(Ptr meta, Ptr node) {
+  // Struct-fors and listgen iterate over slots instead of elements.
+  return ((HashMeta *)meta)->capacity;
+}
+
+i32 *Hash_get_key_ptr(Ptr node, int slot) {
+  return (i32 *)(node + 8 * (1 + slot));
+}
+
+Ptr *Hash_get_data_ptr(Ptr meta, Ptr node, int slot) {
+  auto capacity = ((HashMeta *)meta)->capacity;
+  return (Ptr *)(node + 8 * (1 + capacity + slot));
+}
+
+i32 Hash_get_initial_slot(Ptr meta, int i) {
+  auto capacity = ((HashMeta *)meta)->capacity;
+  // Fibonacci hashing. The capacity is a power of two.
+  u64 h = (u64)(u32)i * 11400714819323198485ull;
+  return i32((h >> 32) & (u64)(capacity - 1));
+}
+
+// Returns the slot holding element |i|, or -1 if |i| is not in the table.
+i32 Hash_find_slot(Ptr meta, Ptr node, int i) {
+  auto capacity = ((HashMeta *)meta)->capacity;
+  auto slot = Hash_get_initial_slot(meta, i);
+  for (int k = 0; k < capacity; k++) {
+    auto key = *(volatile i32 *)Hash_get_key_ptr(node, slot);
+    if (key == i + 1)
+      return slot;
+    if (key == 0)
+      return -1;
+    slot = (slot + 1) & (capacity - 1);
+  }
+  return -1;
+}
+
+// Returns the slot holding element |i|, inserting the key if necessary.
+// Returns -1 if the table is full.
+i32 Hash_insert_slot(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot != -1)
+    return slot;
+  auto capacity = ((HashMeta *)meta)->capacity;
+  auto initial_slot = Hash_get_initial_slot(meta, i);
+  Ptr lock = (Ptr)Hash_get_key_ptr(node, initial_slot) + 4;
+  locked_task(lock, [&] {
+    // Another thread may have inserted |i| before we took the lock
+    slot = Hash_find_slot(meta, node, i);
+    if (slot != -1)
+      return;
+    auto s = initial_slot;
+    for (int k = 0; k < capacity; k++) {
+      auto key_ptr = Hash_get_key_ptr(node, s);
+      i32 key = *(volatile i32 *)key_ptr;
+      // Other keys may claim free slots concurrently. Keep probing if we lose.
+      if ((key == 0 || key == taichi_hash_tombstone) &&
+          __atomic_compare_exchange_n(key_ptr, &key, i + 1, false,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        if (key == taichi_hash_tombstone)
+          atomic_add_i64(Hash_get_num_tombstones_ptr(node), -1);
+        slot = s;
+        return;
+      }
+      s = (s + 1) & (capacity - 1);
+    }
+  });
+  return slot;
+}
+
+void Hash_activate(Ptr meta_, Ptr node, int i) {
+  auto meta = (StructMeta *)meta_;
+  auto slot = Hash_insert_slot(meta_, node, i);
+  if (slot == -1) {
+    taichi_assert_runtime(meta->context->runtime, 0,
+                          "Hash SNode is full. Please increase its capacity.");
+    return;
+  }
+  volatile Ptr lock = (Ptr)Hash_get_key_ptr(node, slot) + 4;
+  volatile Ptr *data_ptr = Hash_get_data_ptr(meta_, node, slot);
+
+  if (*data_ptr == nullptr) {
+    // The cuda_ calls will return 0 or do noop on CPUs
+    u32 mask = cuda_active_mask();
+    if (is_representative(mask, (u64)lock)) {
+      locked_task(lock,
+                  [&] {
+                    auto rt = meta->context->runtime;
+                    auto alloc = rt->node_allocators[meta->snode_id];
+                    auto allocated = (u64)alloc->allocate_thread_local(
+                        meta->context->cpu_thread_id);
+                    atomic_exchange_u64((u64 *)data_ptr, allocated);
+                  },
+                  [&]() { return *data_ptr == nullptr; });
+    }
+    warp_barrier(mask);
+  }
+}
+
+void Hash_deactivate(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot == -1)
+    return;
+  auto smeta = (StructMeta *)meta;
+  auto rt = smeta->context->runtime;
+  Ptr lock = (Ptr)Hash_get_key_ptr(node, slot) + 4;
+  Ptr &data_ptr = *Hash_get_data_ptr(meta, node, slot);
+  auto key_ptr = Hash_get_key_ptr(node, slot);
+  bool released = false;
+  locked_task(lock, [&] {
+    if (*(volatile i32 *)key_ptr != i + 1)
+      return;
+    if (data_ptr != nullptr) {
+      auto alloc = rt->node_allocators[smeta->snode_id];
+      alloc->recycle(data_ptr);
+      data_ptr = nullptr;
+    }
+    // Release the slot. The data pointer is cleared first, so that a key
+    // claiming the tombstone never sees the recycled data.
+    __atomic_store_n(key_ptr, taichi_hash_tombstone, __ATOMIC_SEQ_CST);
+    released = true;
+  });
+  if (!released)
+    return;
+  auto threshold = max_i64(((HashMeta *)meta)->capacity / 8, 1);
+  // Only the deactivation that reaches the threshold queues the table
+  if (atomic_add_i64(Hash_get_num_tombstones_ptr(node), 1) + 1 == threshold)
+    rt->hash_dirty_tables[smeta->snode_id]->push_back(node);
+}
+
+i32 Hash_is_active(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  return slot != -1 && *Hash_get_data_ptr(meta, node, slot) != nullptr;
+}
+
+Ptr Hash_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  Ptr data_ptr = nullptr;
+  if (slot != -1)
+    data_ptr = *Hash_get_data_ptr(meta, node, slot);
+  if (data_ptr == nullptr) {
+    auto smeta = (StructMeta *)meta;
+    auto context = smeta->context;
+    data_ptr = (context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return data_ptr;
+}
+
+// Rebuilds |node| in place without its tombstones. Live keys are first marked
+// as pending (-key - 1), then each is moved to the first empty or pending
+// slot of its probe sequence, swapping with a pending key it meets there.
+// Placed keys are only ever probed past other placed keys, so they stay
+// reachable as the remaining pending slots are emptied.
+void Hash_rebuild(Ptr meta, Ptr node) {
+  auto capacity = ((HashMeta *)meta)->capacity;
+  for (int s = 0; s < capacity; s++) {
+    auto key_ptr = Hash_get_key_ptr(node, s);
+    if (*key_ptr == taichi_hash_tombstone)
+      *key_ptr = 0;
+    else if (*key_ptr > 0)
+      *key_ptr = -*key_ptr - 1;
+  }
+  for (int s = 0; s < capacity; s++) {
+    auto key_ptr = Hash_get_key_ptr(node, s);
+    auto data_ptr = Hash_get_data_ptr(meta, node, s);
+    while (*key_ptr < taichi_hash_tombstone) {
+      i32 key = -*key_ptr - 1;
+      auto t = Hash_get_initial_slot(meta, key - 1);
+      while (t != s && *Hash_get_key_ptr(node, t) > 0)
+        t = (t + 1) & (capacity - 1);
+      if (t == s) {
+        *key_ptr = key;
+        break;
+      }
+      auto target_key_ptr = Hash_get_key_ptr(node, t);
+      auto target_data_ptr = Hash_get_data_ptr(meta, node, t);
+      // Swap with the empty or pending slot |t|, and process what |s| then
+      // holds
+      auto target_key = *target_key_ptr;
+      auto target_data = *target_data_ptr;
+      *target_key_ptr = key;
+      *target_data_ptr = *data_ptr;
+      *key_ptr = target_key;
+      *data_ptr = target_data;
+    }
+  }
+  *Hash_get_num_tombstones_ptr(node) = 0;
+}
+
+// Rebuilds the tables that deactivation queued since the last GC of the hash
+// SNode. Runs on a single thread while no other task touches the tables.
+void Hash_gc(Ptr meta) {
+  auto smeta = (StructMeta *)meta;
+  auto tables = smeta->context->runtime->hash_dirty_tables[smeta->snode_id];
+  for (i64 i = 0; i < tables->size(); i++)
+    Hash_rebuild(meta, tables->get<Ptr>(i));
+  tables->clear();
+}
+
+// Returns the index of the element held by |slot|, or -1 if the slot is empty
+// or its element is inactive.
+i32 Hash_slot_to_index(Ptr meta, Ptr node, int slot) {
+  auto key = *Hash_get_key_ptr(node, slot);
+  if (key <= 0 || *Hash_get_data_ptr(meta, node, slot) == nullptr)
+    return -1;
+  return key - 1;
+}
@@ -52,7 +52,8 @@ void Pointer_activate(Ptr meta_, Ptr node, int i) {
                   [&] {
                     auto rt = meta->context->runtime;
                     auto alloc = rt->node_allocators[meta->snode_id];
-                    auto allocated = (u64)alloc->allocate();
+                    auto allocated = (u64)alloc->allocate_thread_local(
+                        meta->context->cpu_thread_id);
                     // TODO: Not sure if we really need atomic_exchange here,
                     // just to be safe.
                     atomic_exchange_u64((u64 *)data_ptr, allocated);
@@ -23,7 +23,13 @@ using host_vsnprintf_type = int (*)(char *,
                                     const char *,
                                     std::va_list);
 using vm_allocator_type = void *(*)(void *, std::size_t, std::size_t);
+using host_decommit_type = void (*)(void *, void *, std::size_t);
 using RangeForTaskFunc = void(Context *, const char *tls, int i);
+// Runs the loop body on the indices in [begin, end)
+using RangeForBlockTaskFunc = void(Context *,
+                                   const char *tls,
+                                   int begin,
+                                   int end);
 using parallel_for_type = void (*)(void *thread_pool,
                                    int splits,
                                    int num_desired_threads,
@@ -207,7 +213,7 @@ int min_i32(i32 a, i32 b) {
   return a < b ? a : b;
 }
 
-int min_i64(i64 a, i64 b) {
+i64 min_i64(i64 a, i64 b) {
   return a < b ? a : b;
 }
 
@@ -223,7 +229,7 @@ u32 max_u32(u32 a, u32 b) {
   return a > b ? a : b;
 }
 
-int max_i64(i64 a, i64 b) {
+i64 max_i64(i64 a, i64 b) {
   return a > b ? a : b;
 }
 
@@ -338,6 +344,16 @@ struct StructMeta {
 
   i32 (*get_num_elements)(Ptr, Ptr);
 
+  // Maps a slot (an iteration index in [0, get_num_elements)) to the index of
+  // the element it holds, or -1 if the slot holds no active element. Null for
+  // SNodes whose slots are their elements (all but hash).
+  i32 (*slot_to_index)(Ptr, Ptr, int slot);
+
+  // Returns the first slot in [begin, end) that is active (or inactive, if
+  // |active| is 0), or |end| if there is none. Lets listgen and struct-fors
+  // skip runs of inactive cells. Null for SNodes without a bit mask.
+  i32 (*find_next_slot)(Ptr, Ptr, int begin, int end, i32 active);
+
   void (*refine_coordinates)(PhysicalCoordinates *inp_coord,
                              PhysicalCoordinates *refined_coord,
                              int index);
@@ -353,6 +369,8 @@ STRUCT_FIELD(StructMeta, lookup_element);
 STRUCT_FIELD(StructMeta, from_parent_element);
 STRUCT_FIELD(StructMeta, refine_coordinates);
 STRUCT_FIELD(StructMeta, is_active);
+STRUCT_FIELD(StructMeta, slot_to_index);
+STRUCT_FIELD(StructMeta, find_next_slot);
 STRUCT_FIELD(StructMeta, context);
 
 struct LLVMRuntime;
@@ -381,8 +399,8 @@ A simple list data structure that is infinitely long.
 Data are organized in chunks, where each chunk is allocated on demand.
 */
 
-// TODO: there are many i32 types in this class, which may be an issue if there
-// are >= 2 ** 31 elements.
+// Element counts and indices are 64-bit, so that a list may hold >= 2 ** 31
+// elements. Chunk ids stay 32-bit since there are at most |max_num_chunks|.
 struct ListManager {
   static constexpr std::size_t max_num_chunks = 128 * 1024;
   Ptr chunks[max_num_chunks];
@@ -390,7 +408,8 @@ struct ListManager {
   std::size_t max_num_elements_per_chunk;
   i32 log2chunk_num_elements;
   i32 lock;
-  i32 num_elements;
+  // 64-bit so that lists (e.g. of active leaf blocks) can exceed 2^31 elements
+  i64 num_elements;
   LLVMRuntime *runtime;
 
   ListManager(LLVMRuntime *runtime,
@@ -408,13 +427,23 @@ struct ListManager {
 
   void append(void *data_ptr);
 
-  i32 reserve_new_element() {
-    auto i = atomic_add_i32(&num_elements, 1);
+  i64 reserve_new_element() {
+    auto i = atomic_add_i64(&num_elements, 1);
     auto chunk_id = i >> log2chunk_num_elements;
     touch_chunk(chunk_id);
     return i;
   }
 
+  // Reserves |n| consecutive elements and returns the index of the first one.
+  i64 reserve_new_elements(i64 n) {
+    auto i = atomic_add_i64(&num_elements, n);
+    for (int chunk_id = i >> log2chunk_num_elements;
+         chunk_id <= (i + n - 1) >> log2chunk_num_elements; chunk_id++) {
+      touch_chunk(chunk_id);
+    }
+    return i;
+  }
+
   template <typename T>
   void push_back(const T &t) {
     this->append((void *)&t);
@@ -436,40 +465,28 @@ struct ListManager {
     num_elements = 0;
   }
 
-  void resize(i32 n) {
+  void resize(i64 n) {
     num_elements = n;
   }
 
-  Ptr get_element_ptr(i32 i) {
+  Ptr get_element_ptr(i64 i) {
     return chunks[i >> log2chunk_num_elements] +
-           element_size * (i & ((1 << log2chunk_num_elements) - 1));
+           element_size * (i & ((1LL << log2chunk_num_elements) - 1));
   }
 
   template <typename T>
-  T &get(i32 i) {
+  T &get(i64 i) {
     return *(T *)get_element_ptr(i);
   }
 
-  Ptr touch_and_get(i32 i) {
+  Ptr touch_and_get(i64 i) {
     touch_chunk(i >> log2chunk_num_elements);
     return get_element_ptr(i);
   }
 
-  i32 size() {
+  i64 size() {
     return num_elements;
   }
-
-  i32 ptr2index(Ptr ptr) {
-    auto chunk_size = max_num_elements_per_chunk * element_size;
-    for (int i = 0; i < max_num_chunks; i++) {
-      taichi_assert_runtime(runtime, chunks[i] != nullptr, "ptr not found.");
-      if (chunks[i] <= ptr && ptr < chunks[i] + chunk_size) {
-        return (i << log2chunk_num_elements) +
-               i32((ptr - chunks[i]) / element_size);
-      }
-    }
-    return -1;
-  }
 };
 
 extern "C" {
@@ -511,6 +528,9 @@ struct LLVMRuntime {
   Ptr preallocated_tail;
 
   vm_allocator_type vm_allocator;
+  // Returns the pages of a memory range to the OS. Null unless decommitting
+  // is enabled (see NodeManager::decommit_free_chunks).
+  host_decommit_type host_decommit;
   assert_failed_type assert_failed;
   host_printf_type host_printf;
   host_vsnprintf_type host_vsnprintf;
@@ -520,7 +540,17 @@ struct LLVMRuntime {
   Ptr thread_pool;
   parallel_for_type parallel_for;
   ListManager *element_lists[taichi_max_num_snodes];
+  // Task-private element buffers of the parallel CPU listgen, created on
+  // demand
+  ListManager *listgen_buffers[taichi_listgen_max_num_cpu_tasks];
+  // Thread-owned TLS buffers of CPU parallel loops (see cpu_tls_prepare)
+  Ptr cpu_tls_buffers;
+  std::size_t cpu_tls_buffers_size;
   NodeManager *node_allocators[taichi_max_num_snodes];
+  // Allocators of the chunk directory pages of dynamic SNodes
+  NodeManager *dynamic_directory_allocators[taichi_max_num_snodes];
+  // Tables of hash SNodes to rebuild at the next GC (see node_hash.h)
+  ListManager *hash_dirty_tables[taichi_max_num_snodes];
   Ptr ambient_elements[taichi_max_num_snodes];
   Ptr temporaries;
   RandState *rand_states;
@@ -536,6 +566,11 @@ struct LLVMRuntime {
   char error_message_template[taichi_error_message_max_length];
   uint64 error_message_arguments[taichi_error_message_max_num_arguments];
   i32 error_message_lock = 0;
+
+  // Free heap chunks for overflowing autodiff stacks, linked through their
+  // first word (see stack_push)
+  Ptr ad_stack_free_spill_chunks;
+  i32 ad_stack_spill_lock;
   i64 error_code = 0;
 
   Ptr result_buffer;
@@ -544,6 +579,8 @@ struct LLVMRuntime {
   i32 num_rand_states;
 
   i64 total_requested_memory;
+  // Bytes of |total_requested_memory| currently decommitted
+  i64 total_decommitted_memory;
 
   template <typename T>
   void set_result(std::size_t i, T t) {
@@ -575,23 +612,53 @@ STRUCT_FIELD(LLVMRuntime, profiler_stop);
 
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
+// Note that |free_list| and |recycled_list| hold pointers to the elements in
+// |data_list| (instead of their indices), so that recycling a node does not
+// require mapping the pointer back to its index.
 struct NodeManager {
+  // A per-thread cache of free nodes, refilled |taichi_node_magazine_size|
+  // nodes at a time. Only the owning CPU thread touches it.
+  struct alignas(64) Magazine {
+    i32 size;
+    Ptr items[taichi_node_magazine_size];
+  };
+
+  // Free node counts of a |data_list| chunk, see decommit_free_chunks
+  struct ChunkInfo {
+    Ptr begin;
+    i32 id;
+    i32 num_free;
+    i32 num_recycled;
+  };
+
   LLVMRuntime *runtime;
   i32 lock;
 
   i32 element_size;
   i32 chunk_num_elements;
-  i32 free_list_used;
+  i64 free_list_used;
 
   ListManager *free_list, *recycled_list, *data_list;
-  i32 recycle_list_size_backup;
+  i64 recycle_list_size_backup;
+
+  i32 num_magazines;
+  Magazine *magazines;
+
+  // Indexed by position in address order and by chunk id, respectively.
+  // Allocated on first decommit.
+  ChunkInfo *chunk_info;
+  i32 *chunk_decommitted;
+  i64 num_decommitted_chunks;
 
-  using list_data_type = i32;
+  using list_data_type = Ptr;
 
   NodeManager(LLVMRuntime *runtime,
               i32 element_size,
-              i32 chunk_num_elements = -1)
-      : runtime(runtime), element_size(element_size) {
+              i32 chunk_num_elements = -1,
+              i32 num_magazines = 0)
+      : runtime(runtime),
+        element_size(element_size),
+        num_magazines(num_magazines) {
     // 128K elements per chunk, by default
     if (chunk_num_elements == -1) {
       chunk_num_elements = 128 * 1024;
@@ -609,49 +676,171 @@ struct NodeManager {
         runtime, sizeof(list_data_type), chunk_num_elements);
     data_list =
         runtime->create<ListManager>(runtime, element_size, chunk_num_elements);
+    chunk_info = nullptr;
+    chunk_decommitted = nullptr;
+    num_decommitted_chunks = 0;
+    magazines = nullptr;
+    if (num_magazines > 0) {
+      magazines = (Magazine *)runtime->request_allocate_aligned(
+          sizeof(Magazine) * num_magazines, alignof(Magazine));
+      for (int i = 0; i < num_magazines; i++) {
+        magazines[i].size = 0;
+      }
+    }
   }
 
   Ptr allocate() {
-    int old_cursor = atomic_add_i32(&free_list_used, 1);
-    i32 l;
+    i64 old_cursor = atomic_add_i64(&free_list_used, 1);
     if (old_cursor >= free_list->size()) {
       // running out of free list. allocate new.
-      l = data_list->reserve_new_element();
+      auto l = data_list->reserve_new_element();
+      return data_list->get_element_ptr(l);
     } else {
       // reuse
-      l = free_list->get<list_data_type>(old_cursor);
+      return free_list->get<list_data_type>(old_cursor);
     }
-    return data_list->get_element_ptr(l);
   }
 
-  i32 locate(Ptr ptr) {
-    return data_list->ptr2index(ptr);
+  // Same as allocate(), but serves CPU thread |thread_id| from its magazine
+  // when magazines are enabled. Nodes are taken from the free list and the
+  // data list in batches, so that the shared counters are only touched once
+  // per |taichi_node_magazine_size| allocations.
+  Ptr allocate_thread_local(i32 thread_id) {
+    if (thread_id < 0 || thread_id >= num_magazines) {
+      return allocate();
+    }
+    auto &magazine = magazines[thread_id];
+    if (magazine.size == 0) {
+      refill(magazine);
+    }
+    return magazine.items[--magazine.size];
+  }
+
+  void refill(Magazine &magazine) {
+    const i64 n = taichi_node_magazine_size;
+    i64 begin = atomic_add_i64(&free_list_used, n);
+    i64 num_reused = min_i64(max_i64(free_list->size() - begin, 0), n);
+    i64 num_new = n - num_reused;
+    if (num_new > 0) {
+      i64 first = data_list->reserve_new_elements(num_new);
+      for (i64 k = 0; k < num_new; k++) {
+        magazine.items[k] = data_list->get_element_ptr(first + k);
+      }
+    }
+    // Reused nodes are popped first
+    for (i64 k = 0; k < num_reused; k++) {
+      magazine.items[num_new + k] =
+          free_list->get<list_data_type>(begin + num_reused - 1 - k);
+    }
+    magazine.size = n;
   }
 
   void recycle(Ptr ptr) {
-    auto index = locate(ptr);
-    recycled_list->append(&index);
+    recycled_list->append(&ptr);
   }
 
-  void gc_serial() {
+  void gc_serial(bool zero_fill = true) {
     // compact free list
-    for (int i = free_list_used; i < free_list->size(); i++) {
+    for (i64 i = free_list_used; i < free_list->size(); i++) {
       free_list->get<list_data_type>(i - free_list_used) =
           free_list->get<list_data_type>(i);
     }
-    const i32 num_unused = max_i32(free_list->size() - free_list_used, 0);
+    const i64 num_unused = max_i64(free_list->size() - free_list_used, 0);
     free_list_used = 0;
     free_list->resize(num_unused);
 
     // zero-fill recycled and push to free list
-    for (int i = 0; i < recycled_list->size(); i++) {
-      auto idx = recycled_list->get<list_data_type>(i);
-      auto ptr = data_list->get_element_ptr(idx);
-      std::memset(ptr, 0, element_size);
-      free_list->push_back(idx);
+    for (i64 i = 0; i < recycled_list->size(); i++) {
+      auto ptr = recycled_list->get<list_data_type>(i);
+      if (zero_fill)
+        std::memset(ptr, 0, element_size);
+      free_list->push_back(ptr);
     }
+    if (runtime->host_decommit)
+      decommit_free_chunks();
     recycled_list->clear();
   }
+
+  // Returns the position of the chunk holding |ptr| in |chunk_info|.
+  i64 find_chunk(Ptr ptr, i64 num_chunks) {
+    i64 lo = 0, hi = num_chunks - 1;
+    while (lo < hi) {
+      auto mid = (lo + hi + 1) / 2;
+      if (chunk_info[mid].begin <= ptr)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    return lo;
+  }
+
+  // Returns the memory of |data_list| chunks without any allocated node to
+  // the OS. Called by GC after the recycled nodes are pushed to the free
+  // list, but before |recycled_list| is cleared. The nodes of a decommitted
+  // chunk stay in the free list, since its pages read as zero when touched
+  // again. A chunk is only decommitted again if nodes of it were recycled,
+  // i.e. if it has been touched since.
+  void decommit_free_chunks() {
+    // Without recycled nodes no chunk can have become free since the last GC,
+    // so there is nothing to do unless decommitted chunks may have been
+    // reused, which the accounting below must notice.
+    if (recycled_list->size() == 0 && num_decommitted_chunks == 0)
+      return;
+    const i64 num_reserved = data_list->size();
+    const i64 num_chunks =
+        (num_reserved + chunk_num_elements - 1) / chunk_num_elements;
+    if (num_chunks == 0)
+      return;
+    if (chunk_info == nullptr) {
+      chunk_info = (ChunkInfo *)runtime->request_allocate_aligned(
+          sizeof(ChunkInfo) * ListManager::max_num_chunks, 4096);
+      chunk_decommitted = (i32 *)runtime->request_allocate_aligned(
+          sizeof(i32) * ListManager::max_num_chunks, 4096);
+    }
+    // Sort the chunks by address (mostly sorted already, as they come from a
+    // bump allocator), so that nodes can be mapped to their chunks
+    for (i64 c = 0; c < num_chunks; c++) {
+      ChunkInfo info{data_list->chunks[c], (i32)c, 0, 0};
+      i64 k = c;
+      while (k > 0 && chunk_info[k - 1].begin > info.begin) {
+        chunk_info[k] = chunk_info[k - 1];
+        k--;
+      }
+      chunk_info[k] = info;
+    }
+    // Never reserved slots of the last chunk are free, too
+    chunk_info[find_chunk(data_list->chunks[num_chunks - 1], num_chunks)]
+        .num_free += num_chunks * chunk_num_elements - num_reserved;
+    for (i64 i = 0; i < free_list->size(); i++) {
+      auto ptr = free_list->get<list_data_type>(i);
+      chunk_info[find_chunk(ptr, num_chunks)].num_free++;
+    }
+    for (i64 i = 0; i < recycled_list->size(); i++) {
+      auto ptr = recycled_list->get<list_data_type>(i);
+      chunk_info[find_chunk(ptr, num_chunks)].num_recycled++;
+    }
+    const i64 chunk_bytes = (i64)chunk_num_elements * element_size;
+    i64 delta = 0;
+    for (i64 k = 0; k < num_chunks; k++) {
+      auto &info = chunk_info[k];
+      auto &decommitted = chunk_decommitted[info.id];
+      if (info.num_free < chunk_num_elements) {
+        if (decommitted) {
+          decommitted = 0;
+          num_decommitted_chunks--;
+          delta -= chunk_bytes;
+        }
+      } else if (info.num_recycled > 0 || !decommitted) {
+        runtime->host_decommit(runtime->prog, info.begin, chunk_bytes);
+        if (!decommitted) {
+          decommitted = 1;
+          num_decommitted_chunks++;
+          delta += chunk_bytes;
+        }
+      }
+    }
+    atomic_add_i64(&runtime->total_decommitted_memory, delta);
+  }
 };
 
 extern "C" {
@@ -697,6 +886,7 @@ void runtime_ListManager_get_num_active_chunks(LLVMRuntime *runtime,
 RUNTIME_STRUCT_FIELD_ARRAY(LLVMRuntime, node_allocators);
 RUNTIME_STRUCT_FIELD_ARRAY(LLVMRuntime, element_lists);
 RUNTIME_STRUCT_FIELD(LLVMRuntime, total_requested_memory);
+RUNTIME_STRUCT_FIELD(LLVMRuntime, total_decommitted_memory);
 
 RUNTIME_STRUCT_FIELD(NodeManager, free_list);
 RUNTIME_STRUCT_FIELD(NodeManager, recycled_list);
@@ -826,6 +1016,10 @@ void runtime_get_mem_req_queue(LLVMRuntime *runtime) {
                       runtime->mem_req_queue);
 }
 
+void runtime_set_host_decommit(LLVMRuntime *runtime, void *host_decommit) {
+  runtime->host_decommit = (host_decommit_type)host_decommit;
+}
+
 void runtime_initialize(
     Ptr result_buffer,
     Ptr prog,
@@ -866,6 +1060,10 @@ void runtime_initialize(
   runtime->prog = prog;
 
   runtime->total_requested_memory = 0;
+  runtime->total_decommitted_memory = 0;
+  runtime->ad_stack_free_spill_chunks = nullptr;
+  runtime->ad_stack_spill_lock = 0;
+  runtime->host_decommit = nullptr;
 
   // runtime->allocate ready to use
   runtime->mem_req_queue = (MemRequestQueue *)runtime->allocate_aligned(
@@ -917,9 +1115,22 @@ void LLVMRuntime_initialize_thread_pool(LLVMRuntime *runtime,
 
 void runtime_NodeAllocator_initialize(LLVMRuntime *runtime,
                                       int snode_id,
-                                      std::size_t node_size) {
-  runtime->node_allocators[snode_id] =
-      runtime->create<NodeManager>(runtime, node_size, 1024 * 16);
+                                      std::size_t node_size,
+                                      int num_magazines) {
+  runtime->node_allocators[snode_id] = runtime->create<NodeManager>(
+      runtime, node_size, 1024 * 16, num_magazines);
+}
+
+void runtime_DynamicDirectoryAllocator_initialize(LLVMRuntime *runtime,
+                                                  int snode_id,
+                                                  std::size_t page_size) {
+  runtime->dynamic_directory_allocators[snode_id] =
+      runtime->create<NodeManager>(runtime, page_size, 1024);
+}
+
+void runtime_HashDirtyTables_initialize(LLVMRuntime *runtime, int snode_id) {
+  runtime->hash_dirty_tables[snode_id] =
+      runtime->create<ListManager>(runtime, sizeof(Ptr), 1024);
 }
 
 void runtime_allocate_ambient(LLVMRuntime *runtime,
@@ -1097,36 +1308,45 @@ void element_listgen_root(LLVMRuntime *runtime,
   }
 }
 
-void element_listgen_nonroot(LLVMRuntime *runtime,
-                             StructMeta *parent,
-                             StructMeta *child) {
-  auto parent_list = runtime->element_lists[parent->snode_id];
-  int num_parent_elements = parent_list->size();
-  auto child_list = runtime->element_lists[child->snode_id];
+// Generates the child elements of parent elements [i_begin, i_end) (with
+// stride i_step) and appends them to |output|.
+void listgen_nonroot_range(StructMeta *parent,
+                           StructMeta *child,
+                           ListManager *parent_list,
+                           ListManager *output,
+                           i64 i_begin,
+                           i64 i_end,
+                           i64 i_step,
+                           int j_start,
+                           int j_step) {
   // Cache the func pointers here for better compiler optimization
   auto parent_refine_coordinates = parent->refine_coordinates;
   auto parent_is_active = parent->is_active;
   auto parent_lookup_element = parent->lookup_element;
+  auto parent_slot_to_index = parent->slot_to_index;
+  auto parent_find_next_slot = parent->find_next_slot;
   auto child_get_num_elements = child->get_num_elements;
   auto child_from_parent_element = child->from_parent_element;
-#if ARCH_cuda
-  // Each block processes a slice of a parent container
-  int i_start = block_idx();
-  int i_step = grid_dim();
-  // Each thread processes an element of the parent container
-  int j_start = thread_idx();
-  int j_step = block_dim();
-#else
-  int i_start = 0;
-  int i_step = 1;
-  int j_start = 0;
-  int j_step = 1;
-#endif
-  for (int i = i_start; i < num_parent_elements; i += i_step) {
+  for (i64 i = i_begin; i < i_end; i += i_step) {
     auto element = parent_list->get<Element>(i);
     int j_lower = element.loop_bounds[0] + j_start;
     int j_higher = element.loop_bounds[1];
-    for (int j = j_lower; j < j_higher; j += j_step) {
+    for (int j_slot = j_lower; j_slot < j_higher; j_slot += j_step) {
+      if (parent_find_next_slot) {
+        // Skip inactive cells a mask word at a time, then round up to the
+        // next slot of this thread
+        int next = parent_find_next_slot((Ptr)parent, element.element, j_slot,
+                                         j_higher, 1);
+        j_slot += (next - j_slot + j_step - 1) / j_step * j_step;
+        if (j_slot >= j_higher)
+          break;
+      }
+      int j = j_slot;
+      if (parent_slot_to_index) {
+        j = parent_slot_to_index((Ptr)parent, element.element, j_slot);
+        if (j == -1)
+          continue;
+      }
       PhysicalCoordinates refined_coord;
       parent_refine_coordinates(&element.pcoord, &refined_coord, j);
       if (parent_is_active((Ptr)parent, element.element, j)) {
@@ -1144,61 +1364,257 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
           elem.loop_bounds[1] =
               std::min(ch_lower + ch_element_size, ch_num_elements);
           elem.pcoord = refined_coord;
-          child_list->append(&elem);
+          output->append(&elem);
         }
       }
     }
   }
 }
 
+void element_listgen_nonroot(LLVMRuntime *runtime,
+                             StructMeta *parent,
+                             StructMeta *child) {
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  i64 num_parent_elements = parent_list->size();
+  auto child_list = runtime->element_lists[child->snode_id];
+#if ARCH_cuda
+  // Each block processes a slice of a parent container
+  int i_start = block_idx();
+  int i_step = grid_dim();
+  // Each thread processes an element of the parent container
+  int j_start = thread_idx();
+  int j_step = block_dim();
+#else
+  int i_start = 0;
+  int i_step = 1;
+  int j_start = 0;
+  int j_step = 1;
+#endif
+  listgen_nonroot_range(parent, child, parent_list, child_list, i_start,
+                        num_parent_elements, i_step, j_start, j_step);
+}
+
+struct cpu_listgen_helper_context {
+  LLVMRuntime *runtime;
+  StructMeta *parent;
+  StructMeta *child;
+  i64 num_parent_elements;
+  int num_tasks;
+  i64 offsets[taichi_listgen_max_num_cpu_tasks];
+};
+
+// Phase 1: each task expands a contiguous range of parent elements into its
+// private buffer.
+void cpu_listgen_nonroot_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (cpu_listgen_helper_context *)ctx_;
+  auto runtime = ctx->runtime;
+  auto parent_list = runtime->element_lists[ctx->parent->snode_id];
+  auto buffer = runtime->listgen_buffers[task_id];
+  i64 i_begin = ctx->num_parent_elements * task_id / ctx->num_tasks;
+  i64 i_end = ctx->num_parent_elements * (task_id + 1) / ctx->num_tasks;
+  buffer->clear();
+  listgen_nonroot_range(ctx->parent, ctx->child, parent_list, buffer, i_begin,
+                        i_end, 1, 0, 1);
+}
+
+// Phase 2: each task copies its private buffer to the child list, starting
+// from the offset computed by the prefix sum.
+void cpu_listgen_compact_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (cpu_listgen_helper_context *)ctx_;
+  auto runtime = ctx->runtime;
+  auto child_list = runtime->element_lists[ctx->child->snode_id];
+  auto buffer = runtime->listgen_buffers[task_id];
+  auto offset = ctx->offsets[task_id];
+  auto n = buffer->size();
+  for (i64 k = 0; k < n; k++) {
+    std::memcpy(child_list->get_element_ptr(offset + k),
+                buffer->get_element_ptr(k), sizeof(Element));
+  }
+}
+
+// Multithreaded version of element_listgen_nonroot on CPUs. The resulting
+// element order is the same as the serial version.
+void element_listgen_nonroot_cpu(LLVMRuntime *runtime,
+                                 StructMeta *parent,
+                                 StructMeta *child,
+                                 int num_threads) {
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  i64 num_parent_elements = parent_list->size();
+  if (num_threads <= 1 || num_parent_elements <= 1) {
+    element_listgen_nonroot(runtime, parent, child);
+    return;
+  }
+  auto child_list = runtime->element_lists[child->snode_id];
+
+  cpu_listgen_helper_context ctx;
+  ctx.runtime = runtime;
+  ctx.parent = parent;
+  ctx.child = child;
+  ctx.num_parent_elements = num_parent_elements;
+  // A few tasks per thread for load balancing
+  ctx.num_tasks = (int)std::min(
+      num_parent_elements,
+      (i64)std::min(num_threads * 4, taichi_listgen_max_num_cpu_tasks));
+  for (int t = 0; t < ctx.num_tasks; t++) {
+    if (runtime->listgen_buffers[t] == nullptr) {
+      runtime->listgen_buffers[t] =
+          runtime->create<ListManager>(runtime, sizeof(Element), 1024 * 4);
+    }
+  }
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_listgen_nonroot_task);
+
+  // Exclusive prefix sum of the buffer sizes
+  i64 total = 0;
+  for (int t = 0; t < ctx.num_tasks; t++) {
+    ctx.offsets[t] = total;
+    total += runtime->listgen_buffers[t]->size();
+  }
+  if (total == 0)
+    return;
+  auto base = child_list->reserve_new_elements(total);
+  for (int t = 0; t < ctx.num_tasks; t++) {
+    ctx.offsets[t] += base;
+  }
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_listgen_compact_task);
+}
+
 using BlockTask = void(Context *, char *, Element *, int, int);
 
+using range_for_xlogue = void (*)(Context *, /*TLS*/ char *tls_base);
+
+// On CPUs, each worker thread owns one TLS buffer per parallel loop launch,
+// instead of one per task. The TLS prologue runs when a thread picks up its
+// first task, and the epilogue runs once per participating thread after the
+// launch, so that e.g. thread-local reductions merge once per thread.
+//
+// A thread's slot is a header followed by its TLS buffer. The first word of
+// the header records whether the prologue has run in the current launch.
+constexpr std::size_t cpu_tls_header_size = 64;
+
+std::size_t cpu_tls_stride(std::size_t tls_size) {
+  // Keep the slots of different threads on different cache lines
+  return cpu_tls_header_size + taichi::iroundup(tls_size, (std::size_t)64);
+}
+
+Ptr cpu_tls_prepare(LLVMRuntime *runtime,
+                    int num_threads,
+                    std::size_t tls_stride) {
+  auto size = tls_stride * num_threads;
+  if (runtime->cpu_tls_buffers_size < size) {
+    // The runtime allocator cannot free the old buffers. Grow geometrically,
+    // so that they add up to less than the final buffer.
+    size = max_i64(size, runtime->cpu_tls_buffers_size * 2);
+    runtime->cpu_tls_buffers = runtime->request_allocate_aligned(size, 64);
+    runtime->cpu_tls_buffers_size = size;
+  }
+  for (int t = 0; t < num_threads; t++) {
+    *(i32 *)(runtime->cpu_tls_buffers + tls_stride * t) = 0;
+  }
+  return runtime->cpu_tls_buffers;
+}
+
+char *cpu_tls_acquire(Context *context,
+                      Ptr tls_buffers,
+                      std::size_t tls_stride,
+                      int thread_id,
+                      range_for_xlogue prologue) {
+  auto header = tls_buffers + tls_stride * thread_id;
+  auto tls = (char *)header + cpu_tls_header_size;
+  if (*(i32 *)header == 0) {
+    *(i32 *)header = 1;
+    if (prologue)
+      prologue(context, tls);
+  }
+  return tls;
+}
+
+void cpu_tls_finish(Context *context,
+                    Ptr tls_buffers,
+                    std::size_t tls_stride,
+                    int num_threads,
+                    range_for_xlogue epilogue) {
+  if (!epilogue)
+    return;
+  for (int t = 0; t < num_threads; t++) {
+    auto header = tls_buffers + tls_stride * t;
+    if (*(i32 *)header)
+      epilogue(context, (char *)header + cpu_tls_header_size);
+  }
+}
+
 struct cpu_block_task_helper_context {
   Context *context;
   BlockTask *task;
   ListManager *list;
   int element_size;
   int element_split;
-  std::size_t tls_buffer_size;
+  // Non-null if the cells of the leaf block can be skipped by mask words
+  StructMeta *leaf_meta;
+  // Index of the first task of the current batch (see parallel_struct_for)
+  i64 task_id_base;
+  range_for_xlogue tls_prologue;
+  Ptr tls_buffers;
+  std::size_t tls_stride;
 };
 
 // TODO: To enforce inlining, we need to create in LLVM a new function that
 // calls block_helper and the BLS xlogues, and pass that function to the
 // scheduler.
 
-// TODO: TLS should be directly passed to the scheduler, so that it lives
-// with the threads (instead of blocks).
-
 void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
   auto ctx = (cpu_block_task_helper_context *)(ctx_);
-  int element_id = i / ctx->element_split;
+  i64 task_id = ctx->task_id_base + i;
+  i64 element_id = task_id / ctx->element_split;
   int part_size = ctx->element_size / ctx->element_split;
-  int part_id = i % ctx->element_split;
+  int part_id = task_id % ctx->element_split;
   auto &e = ctx->list->get<Element>(element_id);
   int lower = e.loop_bounds[0] + part_id * part_size;
   int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
   upper = std::min(upper, e.loop_bounds[1]);
-  alignas(8) char tls_buffer[ctx->tls_buffer_size];
+  if (lower >= upper)
+    return;
 
+  auto tls_buffer = cpu_tls_acquire(ctx->context, ctx->tls_buffers,
+                                    ctx->tls_stride, thread_id,
+                                    ctx->tls_prologue);
   Context this_thread_context = *ctx->context;
   this_thread_context.cpu_thread_id = thread_id;
-  if (lower < upper) {
-    (*ctx->task)(&this_thread_context, tls_buffer,
-                 &ctx->list->get<Element>(element_id), lower, upper);
+  if (ctx->leaf_meta == nullptr) {
+    (*ctx->task)(&this_thread_context, tls_buffer, &e, lower, upper);
+    return;
+  }
+  // Only run the task on runs of active cells
+  auto find_next_slot = ctx->leaf_meta->find_next_slot;
+  while (true) {
+    lower = find_next_slot((Ptr)ctx->leaf_meta, e.element, lower, upper, 1);
+    if (lower >= upper)
+      break;
+    int run_end =
+        find_next_slot((Ptr)ctx->leaf_meta, e.element, lower + 1, upper, 0);
+    (*ctx->task)(&this_thread_context, tls_buffer, &e, lower, run_end);
+    lower = run_end;
   }
 }
 
+// |leaf_meta|, |tls_prologue| and |tls_epilogue| are only used on CPUs. On
+// GPUs, |task| runs the TLS xlogues itself. |leaf_meta| is the meta of a
+// bitmasked leaf block, or nullptr.
 void parallel_struct_for(Context *context,
                          int snode_id,
                          int element_size,
                          int element_split,
+                         StructMeta *leaf_meta,
                          BlockTask *task,
+                         range_for_xlogue tls_prologue,
+                         range_for_xlogue tls_epilogue,
                          std::size_t tls_buffer_size,
                          int num_threads) {
   auto list = (context->runtime)->element_lists[snode_id];
   auto list_tail = list->size();
 #if ARCH_cuda
-  int i = block_idx();
+  i64 i = block_idx();
   // Note: CUDA requires compile-time constant local array sizes.
   // We use "1" here and modify it during codegen to tls_buffer_size.
   alignas(8) char tls_buffer[1];
@@ -1206,7 +1622,7 @@ void parallel_struct_for(Context *context,
   element_split = 1;
   const auto part_size = element_size / element_split;
   while (true) {
-    int element_id = i / element_split;
+    i64 element_id = i / element_split;
     if (element_id >= list_tail)
       break;
     auto part_id = i % element_split;
@@ -1219,27 +1635,43 @@ void parallel_struct_for(Context *context,
     i += grid_dim();
   }
 #else
+  if (context->cpu_element_split)
+    element_split = context->cpu_element_split;
+  if (context->cpu_num_threads)
+    num_threads = min_i32(num_threads, context->cpu_num_threads);
   cpu_block_task_helper_context ctx;
   ctx.context = context;
   ctx.task = task;
   ctx.list = list;
   ctx.element_size = element_size;
   ctx.element_split = element_split;
-  ctx.tls_buffer_size = tls_buffer_size;
+  ctx.leaf_meta = leaf_meta;
+  ctx.tls_prologue = tls_prologue;
+  ctx.tls_stride = cpu_tls_stride(tls_buffer_size);
   auto runtime = context->runtime;
-  runtime->parallel_for(runtime->thread_pool, list_tail * element_split,
-                        num_threads, &ctx, cpu_struct_for_block_helper);
+  ctx.tls_buffers = cpu_tls_prepare(runtime, num_threads, ctx.tls_stride);
+  // The thread pool takes 32-bit task counts. Launch in batches so that lists
+  // with more than 2^31 tasks are still fully covered.
+  const i64 num_tasks = list_tail * element_split;
+  const i64 max_tasks_per_launch = 1LL << 30;
+  for (i64 base = 0; base < num_tasks; base += max_tasks_per_launch) {
+    ctx.task_id_base = base;
+    runtime->parallel_for(runtime->thread_pool,
+                          (int)std::min(num_tasks - base, max_tasks_per_launch),
+                          num_threads, &ctx, cpu_struct_for_block_helper);
+  }
+  cpu_tls_finish(context, ctx.tls_buffers, ctx.tls_stride, num_threads,
+                 tls_epilogue);
 #endif
 }
 
-using range_for_xlogue = void (*)(Context *, /*TLS*/ char *tls_base);
-
 struct range_task_helper_context {
   Context *context;
   range_for_xlogue prologue{nullptr};
   RangeForTaskFunc *body{nullptr};
-  range_for_xlogue epilogue{nullptr};
-  std::size_t tls_size{1};
+  RangeForBlockTaskFunc *block_body{nullptr};
+  Ptr tls_buffers{nullptr};
+  std::size_t tls_stride{0};
   int begin;
   int end;
   int block_size;
@@ -1250,18 +1682,20 @@ void cpu_parallel_range_for_task(void *range_context,
                                  int thread_id,
                                  int task_id) {
   auto ctx = *(range_task_helper_context *)range_context;
-  alignas(8) char tls_buffer[ctx.tls_size];
-  auto tls_ptr = &tls_buffer[0];
-  if (ctx.prologue)
-    ctx.prologue(ctx.context, tls_ptr);
+  auto tls_ptr = cpu_tls_acquire(ctx.context, ctx.tls_buffers, ctx.tls_stride,
+                                 thread_id, ctx.prologue);
 
   Context this_thread_context = *ctx.context;
   this_thread_context.cpu_thread_id = thread_id;
   if (ctx.step == 1) {
     int block_start = ctx.begin + task_id * ctx.block_size;
     int block_end = std::min(block_start + ctx.block_size, ctx.end);
-    for (int i = block_start; i < block_end; i++) {
-      ctx.body(&this_thread_context, tls_ptr, i);
+    if (ctx.block_body) {
+      ctx.block_body(&this_thread_context, tls_ptr, block_start, block_end);
+    } else {
+      for (int i = block_start; i < block_end; i++) {
+        ctx.body(&this_thread_context, tls_ptr, i);
+      }
     }
   } else if (ctx.step == -1) {
     int block_start = ctx.end - task_id * ctx.block_size;
@@ -1270,8 +1704,6 @@ void cpu_parallel_range_for_task(void *range_context,
       ctx.body(&this_thread_context, tls_ptr, i);
     }
   }
-  if (ctx.epilogue)
-    ctx.epilogue(ctx.context, tls_ptr);
 }
 
 void cpu_parallel_range_for(Context *context,
@@ -1282,14 +1714,14 @@ void cpu_parallel_range_for(Context *context,
                             int block_dim,
                             range_for_xlogue prologue,
                             RangeForTaskFunc *body,
+                            RangeForBlockTaskFunc *block_body,
                             range_for_xlogue epilogue,
                             std::size_t tls_size) {
   range_task_helper_context ctx;
   ctx.context = context;
   ctx.prologue = prologue;
-  ctx.tls_size = tls_size;
   ctx.body = body;
-  ctx.epilogue = epilogue;
+  ctx.block_body = block_body;
   ctx.begin = begin;
   ctx.end = end;
   ctx.step = step;
@@ -1297,6 +1729,10 @@ void cpu_parallel_range_for(Context *context,
     taichi_printf(context->runtime, "step must not be %d\n", step);
     exit(-1);
   }
+  if (context->cpu_num_threads)
+    num_threads = min_i32(num_threads, context->cpu_num_threads);
+  if (context->cpu_block_dim)
+    block_dim = context->cpu_block_dim;
   if (block_dim == 0) {
     // adaptive block dim
     auto num_items = (ctx.end - ctx.begin) / std::abs(step);
@@ -1306,9 +1742,13 @@ void cpu_parallel_range_for(Context *context,
   }
   ctx.block_size = block_dim;
   auto runtime = context->runtime;
+  ctx.tls_stride = cpu_tls_stride(tls_size);
+  ctx.tls_buffers = cpu_tls_prepare(runtime, num_threads, ctx.tls_stride);
   runtime->parallel_for(runtime->thread_pool,
                         (end - begin + block_dim - 1) / block_dim, num_threads,
                         &ctx, cpu_parallel_range_for_task);
+  cpu_tls_finish(context, ctx.tls_buffers, ctx.tls_stride, num_threads,
+                 epilogue);
 }
 
 void gpu_parallel_range_for(Context *context,
@@ -1344,6 +1784,7 @@ i32 linear_thread_idx(Context *context) {
 #include "node_pointer.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
+#include "node_hash.h"
 
 void ListManager::touch_chunk(int chunk_id) {
   taichi_assert_runtime(runtime, chunk_id < max_num_chunks,
@@ -1371,8 +1812,106 @@ Ptr ListManager::allocate() {
   return get_element_ptr(i);
 }
 
-void node_gc(LLVMRuntime *runtime, int snode_id) {
-  runtime->node_allocators[snode_id]->gc_serial();
+void node_gc(LLVMRuntime *runtime, int snode_id, i32 zero_fill) {
+  runtime->node_allocators[snode_id]->gc_serial(zero_fill);
+}
+
+struct cpu_gc_helper_context {
+  NodeManager *allocator;
+  // Phase 0: move |num_items_to_move| free list items starting from
+  // |move_src_offset| to the beginning of the free list
+  i64 num_items_to_move;
+  i64 move_src_offset;
+  // Phase 1: push the recycled elements to the free list, starting from
+  // |free_list_offset|
+  i64 num_recycled;
+  i64 free_list_offset;
+  i32 num_tasks;
+  bool zero_fill;
+};
+
+void cpu_gc_compact_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (cpu_gc_helper_context *)ctx_;
+  auto free_list = ctx->allocator->free_list;
+  using T = NodeManager::list_data_type;
+  i64 begin = ctx->num_items_to_move * task_id / ctx->num_tasks;
+  i64 end = ctx->num_items_to_move * (task_id + 1) / ctx->num_tasks;
+  for (i64 i = begin; i < end; i++) {
+    free_list->get<T>(i) = free_list->get<T>(ctx->move_src_offset + i);
+  }
+}
+
+void cpu_gc_recycle_task(void *ctx_, int thread_id, int task_id) {
+  auto ctx = (cpu_gc_helper_context *)ctx_;
+  auto allocator = ctx->allocator;
+  auto free_list = allocator->free_list;
+  auto recycled_list = allocator->recycled_list;
+  auto element_size = allocator->element_size;
+  using T = NodeManager::list_data_type;
+  i64 begin = ctx->num_recycled * task_id / ctx->num_tasks;
+  i64 end = ctx->num_recycled * (task_id + 1) / ctx->num_tasks;
+  for (i64 i = begin; i < end; i++) {
+    auto ptr = recycled_list->get<T>(i);
+    if (ctx->zero_fill)
+      std::memset(ptr, 0, element_size);
+    free_list->get<T>(ctx->free_list_offset + i) = ptr;
+  }
+}
+
+// Multithreaded version of NodeManager::gc_serial on CPUs.
+void node_gc_cpu(LLVMRuntime *runtime,
+                 int snode_id,
+                 int num_threads,
+                 i32 zero_fill) {
+  auto allocator = runtime->node_allocators[snode_id];
+  auto free_list = allocator->free_list;
+  auto recycled_list = allocator->recycled_list;
+  auto free_list_size = free_list->size();
+  auto free_list_used = allocator->free_list_used;
+  auto num_recycled = recycled_list->size();
+  // Not worth waking up the thread pool for small lists
+  constexpr int min_items_per_task = 1024;
+  if (num_threads <= 1 ||
+      std::max(free_list_size, num_recycled) < 2 * min_items_per_task) {
+    allocator->gc_serial(zero_fill);
+    return;
+  }
+  cpu_gc_helper_context ctx;
+  ctx.allocator = allocator;
+  ctx.zero_fill = zero_fill;
+
+  // Move unused elements to the beginning of the free_list, making sure that
+  // the source and destination do not overlap (see gc_parallel_0).
+  const i64 num_unused = max_i64(free_list_size - free_list_used, 0);
+  if (free_list_used >= num_unused) {
+    ctx.num_items_to_move = num_unused;
+    ctx.move_src_offset = free_list_used;
+  } else {
+    ctx.num_items_to_move = free_list_used;
+    ctx.move_src_offset = free_list_size - free_list_used;
+  }
+  if (ctx.num_items_to_move > 0) {
+    ctx.num_tasks = (int)std::min(
+        (i64)num_threads * 4, ctx.num_items_to_move / min_items_per_task + 1);
+    runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads,
+                          &ctx, cpu_gc_compact_task);
+  }
+  allocator->free_list_used = 0;
+  free_list->resize(num_unused);
+
+  // zero-fill recycled and push to free list
+  if (num_recycled > 0) {
+    ctx.num_recycled = num_recycled;
+    ctx.free_list_offset = free_list->reserve_new_elements(num_recycled);
+    ctx.num_tasks =
+        (int)std::min((i64)num_threads * 4,
+                      num_recycled / min_items_per_task + 1);
+    runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads,
+                          &ctx, cpu_gc_recycle_task);
+  }
+  if (runtime->host_decommit)
+    allocator->decommit_free_chunks();
+  recycled_list->clear();
 }
 
 void gc_parallel_0(Context *context, int snode_id) {
@@ -1384,7 +1923,7 @@ void gc_parallel_0(Context *context, int snode_id) {
   using T = NodeManager::list_data_type;
 
   // Move unused elements to the beginning of the free_list
-  int i = linear_thread_idx(context);
+  i64 i = linear_thread_idx(context);
   if (free_list_used * 2 > free_list_size) {
     // Directly copy. Dst and src does not overlap
     auto items_to_copy = free_list_size - free_list_used;
@@ -1408,8 +1947,8 @@ void gc_parallel_1(Context *context, int snode_id) {
   auto allocator = runtime->node_allocators[snode_id];
   auto free_list = allocator->free_list;
 
-  const i32 num_unused =
-      max_i32(free_list->size() - allocator->free_list_used, 0);
+  const i64 num_unused =
+      max_i64(free_list->size() - allocator->free_list_used, 0);
   free_list->resize(num_unused);
 
   allocator->free_list_used = 0;
@@ -1417,21 +1956,23 @@ void gc_parallel_1(Context *context, int snode_id) {
   allocator->recycled_list->clear();
 }
 
-void gc_parallel_2(Context *context, int snode_id) {
+void gc_parallel_2(Context *context, int snode_id, i32 zero_fill) {
   LLVMRuntime *runtime = context->runtime;
   auto allocator = runtime->node_allocators[snode_id];
   auto elements = allocator->recycle_list_size_backup;
   auto free_list = allocator->free_list;
   auto recycled_list = allocator->recycled_list;
-  auto data_list = allocator->data_list;
   auto element_size = allocator->element_size;
   using T = NodeManager::list_data_type;
-  auto i = block_idx();
+  i64 i = block_idx();
   while (i < elements) {
-    auto idx = recycled_list->get<T>(i);
-    auto ptr = data_list->get_element_ptr(idx);
+    auto ptr = recycled_list->get<T>(i);
     if (thread_idx() == 0) {
-      free_list->push_back(idx);
+      free_list->push_back(ptr);
+    }
+    if (!zero_fill) {
+      i += grid_dim();
+      continue;
     }
     // memset
     auto ptr_stop = ptr + element_size;
@@ -1499,6 +2040,81 @@ i32 rand_i32(Context *context) {
 i64 rand_i64(Context *context) {
   return rand_u64(context);
 }
+
+// Counter-based generator, used when CompileConfig::random_counter_based is
+// on. Each number is Philox-4x32-10 (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3", SC'11) of the counter (iteration, *counter,
+// kernel launch, iteration >> 32) under the key (seed, call_site), where
+// |iteration| identifies the loop iteration and |*counter| is the number of
+// calls made by it so far. The results do not depend on which thread runs the
+// iteration, and no state is shared between iterations.
+u64 counter_rand_u64(Context *context,
+                     u32 seed,
+                     u32 call_site,
+                     u64 iteration,
+                     u32 *counter) {
+  u32 c0 = u32(iteration), c1 = *counter, c2 = context->rand_launch_id,
+      c3 = u32(iteration >> 32);
+  u32 k0 = seed, k1 = call_site;
+  *counter += 1;
+  for (int round = 0; round < 10; round++) {
+    u64 p0 = (u64)0xD2511F53u * c0;
+    u64 p1 = (u64)0xCD9E8D57u * c2;
+    u32 n0 = u32(p1 >> 32) ^ c1 ^ k0;
+    u32 n2 = u32(p0 >> 32) ^ c3 ^ k1;
+    c1 = u32(p1);
+    c3 = u32(p0);
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  return ((u64)c0 << 32) | c1;
+}
+
+u32 counter_rand_u32(Context *context,
+                     u32 seed,
+                     u32 call_site,
+                     u64 iteration,
+                     u32 *counter) {
+  return (u32)counter_rand_u64(context, seed, call_site, iteration, counter);
+}
+
+f32 counter_rand_f32(Context *context,
+                     u32 seed,
+                     u32 call_site,
+                     u64 iteration,
+                     u32 *counter) {
+  return counter_rand_u32(context, seed, call_site, iteration, counter) *
+         (1.0f / 4294967296.0f);
+}
+
+f64 counter_rand_f64(Context *context,
+                     u32 seed,
+                     u32 call_site,
+                     u64 iteration,
+                     u32 *counter) {
+  // Use the 53 high bits, so that the result is below 1
+  auto bits =
+      counter_rand_u64(context, seed, call_site, iteration, counter) >> 11;
+  return bits * (1.0 / 9007199254740992.0);
+}
+
+i32 counter_rand_i32(Context *context,
+                     u32 seed,
+                     u32 call_site,
+                     u64 iteration,
+                     u32 *counter) {
+  return counter_rand_u32(context, seed, call_site, iteration, counter);
+}
+
+i64 counter_rand_i64(Context *context,
+                     u32 seed,
+                     u32 call_site,
+                     u64 iteration,
+                     u32 *counter) {
+  return counter_rand_u64(context, seed, call_site, iteration, counter);
+}
 };
 
 struct printf_helper {
@@ -1545,29 +2161,109 @@ void taichi_printf(LLVMRuntime *runtime, const char *format, Args &&... args) {
 
 extern "C" {  // local stack operations
 
-Ptr stack_top_primal(Ptr stack, std::size_t element_size) {
-  auto n = *(u64 *)stack;
-  return stack + sizeof(u64) + (n - 1) * 2 * element_size;
+// An autodiff stack holds its first |max_num_elements| (primal, adjoint)
+// entries inline, after the header. Further entries spill to a linked list of
+// heap chunks of taichi_ad_stack_spill_chunk_size bytes, so that an
+// undersized stack only costs speed. Chunks start with a pointer to the chunk
+// below them, and are recycled through a runtime-wide free list when the
+// stack shrinks.
+struct ADStackHeader {
+  u64 n;
+  Ptr spill_top;
+};
+
+constexpr std::size_t ad_stack_spill_chunk_header_size = 16;
+
+i64 stack_spill_chunk_capacity(std::size_t element_size) {
+  return (taichi_ad_stack_spill_chunk_size -
+          ad_stack_spill_chunk_header_size) /
+         (2 * element_size);
 }
 
-Ptr stack_top_adjoint(Ptr stack, std::size_t element_size) {
-  return stack_top_primal(stack, element_size) + element_size;
+Ptr stack_top_primal(Ptr stack,
+                     std::size_t max_num_elements,
+                     std::size_t element_size) {
+  auto header = (ADStackHeader *)stack;
+  i64 i = header->n - 1;
+  if (i < (i64)max_num_elements)
+    return stack + taichi_ad_stack_header_size + i * 2 * element_size;
+  i = (i - max_num_elements) % stack_spill_chunk_capacity(element_size);
+  return header->spill_top + ad_stack_spill_chunk_header_size +
+         i * 2 * element_size;
+}
+
+Ptr stack_top_adjoint(Ptr stack,
+                      std::size_t max_num_elements,
+                      std::size_t element_size) {
+  return stack_top_primal(stack, max_num_elements, element_size) +
+         element_size;
 }
 
 void stack_init(Ptr stack) {
-  *(u64 *)stack = 0;
+  auto header = (ADStackHeader *)stack;
+  header->n = 0;
+  header->spill_top = nullptr;
+}
+
+Ptr stack_allocate_spill_chunk(LLVMRuntime *runtime) {
+  Ptr chunk = nullptr;
+  locked_task(&runtime->ad_stack_spill_lock, [&] {
+    if (runtime->ad_stack_free_spill_chunks == nullptr) {
+      // Request chunks in batches, to save memory requests
+      constexpr int batch_size = 64;
+      auto batch = runtime->request_allocate_aligned(
+          taichi_ad_stack_spill_chunk_size * batch_size, taichi_page_size);
+      for (int i = 0; i < batch_size; i++) {
+        auto c = batch + i * taichi_ad_stack_spill_chunk_size;
+        *(Ptr *)c = runtime->ad_stack_free_spill_chunks;
+        runtime->ad_stack_free_spill_chunks = c;
+      }
+    }
+    chunk = runtime->ad_stack_free_spill_chunks;
+    runtime->ad_stack_free_spill_chunks = *(Ptr *)chunk;
+  });
+  return chunk;
 }
 
-void stack_pop(Ptr stack) {
-  auto &n = *(u64 *)stack;
-  n--;
+void stack_recycle_spill_chunk(LLVMRuntime *runtime, Ptr chunk) {
+  locked_task(&runtime->ad_stack_spill_lock, [&] {
+    *(Ptr *)chunk = runtime->ad_stack_free_spill_chunks;
+    runtime->ad_stack_free_spill_chunks = chunk;
+  });
 }
 
-void stack_push(Ptr stack, size_t max_num_elements, std::size_t element_size) {
-  u64 &n = *(u64 *)stack;
-  n += 1;
-  // TODO: assert n <= max_elements
-  std::memset(stack_top_primal(stack, element_size), 0, element_size * 2);
+void stack_pop(LLVMRuntime *runtime,
+               Ptr stack,
+               std::size_t max_num_elements,
+               std::size_t element_size) {
+  auto header = (ADStackHeader *)stack;
+  i64 i = header->n - 1;
+  if (i >= (i64)max_num_elements &&
+      (i - max_num_elements) % stack_spill_chunk_capacity(element_size) == 0) {
+    // The top entry is the last one in its chunk
+    auto chunk = header->spill_top;
+    header->spill_top = *(Ptr *)chunk;
+    stack_recycle_spill_chunk(runtime, chunk);
+  }
+  header->n--;
+}
+
+void stack_push(LLVMRuntime *runtime,
+                Ptr stack,
+                std::size_t max_num_elements,
+                std::size_t element_size) {
+  auto header = (ADStackHeader *)stack;
+  i64 i = header->n;
+  if (i >= (i64)max_num_elements &&
+      (i - max_num_elements) % stack_spill_chunk_capacity(element_size) == 0) {
+    // The new entry starts a chunk
+    auto chunk = stack_allocate_spill_chunk(runtime);
+    *(Ptr *)chunk = header->spill_top;
+    header->spill_top = chunk;
+  }
+  header->n++;
+  std::memset(stack_top_primal(stack, max_num_elements, element_size), 0,
+              element_size * 2);
 }
 
 #include "internal_functions.h"
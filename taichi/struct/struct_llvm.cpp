@@ -49,8 +49,9 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
   snode.cell_size_bytes = tlctx->get_type_size(ch_type);
 
   llvm::Type *body_type = nullptr, *aux_type = nullptr;
+  TI_ERROR_IF(snode._morton && type != SNodeType::dense,
+              "Morton layout is only supported on dense SNodes.");
   if (type == SNodeType::dense || type == SNodeType::bitmasked) {
-    TI_ASSERT(snode._morton == false);
     body_type = llvm::ArrayType::get(ch_type, snode.max_num_elements());
     if (type == SNodeType::bitmasked) {
       aux_type = llvm::ArrayType::get(llvm::Type::getInt32Ty(*llvm_ctx),
@@ -118,6 +119,20 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
                                     snode.max_num_elements());
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
+  } else if (type == SNodeType::hash) {
+    // The table never needs more slots than the number of elements
+    int64 capacity = snode.hash_capacity;
+    if (capacity == 0)
+      capacity = taichi_default_hash_capacity;
+    capacity = std::min(capacity, snode.max_num_elements());
+    snode.hash_capacity = (int)bit::least_pot_bound(capacity);
+    // tombstone count, then keys and mutexes (see node_hash.h)
+    aux_type = llvm::StructType::get(
+        *ctx, {llvm::PointerType::getInt64Ty(*ctx),
+               llvm::ArrayType::get(llvm::PointerType::getInt64Ty(*ctx),
+                                    snode.hash_capacity)});
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     snode.hash_capacity);
   } else if (type == SNodeType::dynamic) {
     // mutex and n (number of elements)
     aux_type =
@@ -184,7 +199,16 @@ void StructCompilerLLVM::generate_refine_coordinates(SNode *snode) {
 
   for (int i = 0; i < taichi_max_num_indices; i++) {
     auto addition = tlctx->get_constant(0);
-    if (snode->extractors[i].num_bits) {
+    if (snode->_morton) {
+      // Gather the bits of index i, which are interleaved with the others
+      for (int b = 0; b < snode->extractors[i].num_bits; b++) {
+        auto bit = builder.CreateAnd(
+            builder.CreateAShr(l, snode->morton_bit_position(i, b)), 1);
+        addition = builder.CreateOr(
+            addition,
+            builder.CreateShl(bit, snode->extractors[i].start + b));
+      }
+    } else if (snode->extractors[i].num_bits) {
       auto mask = ((1 << snode->extractors[i].num_bits) - 1);
       addition = builder.CreateAnd(
           builder.CreateAShr(l, snode->extractors[i].acc_offset), mask);
@@ -40,8 +40,9 @@ void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
   if (!ret) {
     // allocation have failed
     auto new_buffer_size = std::max(size, default_allocator_size);
-    allocators.emplace_back(
-        std::make_unique<UnifiedAllocator>(new_buffer_size, prog->config.arch));
+    allocators.emplace_back(std::make_unique<UnifiedAllocator>(
+        new_buffer_size, prog->config.arch,
+        prog->config.cpu_numa_memory_policy, prog->config.cpu_huge_pages));
     ret = allocators.back()->allocate(size, alignment);
   }
   TI_ASSERT(ret);
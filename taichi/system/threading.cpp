@@ -13,13 +13,91 @@
 #include <unistd.h>
 #endif
 
+#if defined(TI_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include <algorithm>
 #include <condition_variable>
 #include <thread>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 TI_NAMESPACE_BEGIN
 
+namespace {
+
+// Number of polling iterations before a worker (or the master) parks itself
+// on a condition variable.
+constexpr int kNumSpinsBeforeParking = 1 << 12;
+// After this many busy-wait iterations, yield the core on each poll so that
+// oversubscribed machines still make progress.
+constexpr int kNumSpinsBeforeYielding = 64;
+
+inline void spin_pause(int num_spins) {
+  if (num_spins >= kNumSpinsBeforeYielding) {
+    std::this_thread::yield();
+    return;
+  }
+#if defined(__x86_64__) || defined(_M_X64)
+  _mm_pause();
+#endif
+}
+
+#if defined(TI_PLATFORM_LINUX)
+// The CPUs this process may run on (e.g. under taskset or cgroup cpusets), in
+// ascending order. Queried once, before any thread of ours is pinned.
+const std::vector<int> &allowed_cpus() {
+  static const std::vector<int> cpus = [] {
+    std::vector<int> ret;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+      for (int i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &cpu_set))
+          ret.push_back(i);
+      }
+    }
+    return ret;
+  }();
+  return cpus;
+}
+#endif
+
+// Pins the calling thread to the |index|-th CPU of the process affinity mask,
+// modulo the number of such CPUs. Linux only; a no-op elsewhere.
+void pin_current_thread(int index) {
+#if defined(TI_PLATFORM_LINUX)
+  const auto &cpus = allowed_cpus();
+  if (cpus.empty())
+    return;
+  int cpu = cpus[index % (int)cpus.size()];
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+    TI_WARN("Failed to pin thread to CPU {}", cpu);
+#endif
+}
+
+inline uint64 pack_range(uint32 begin, uint32 end) {
+  return ((uint64)begin << 32) | end;
+}
+
+inline uint32 range_begin(uint64 range) {
+  return uint32(range >> 32);
+}
+
+inline uint32 range_end(uint64 range) {
+  return uint32(range & 0xFFFFFFFFu);
+}
+
+}  // namespace
+
 bool test_threading() {
   auto tp = ThreadPool(20);
   for (int j = 0; j < 100; j++) {
@@ -51,7 +129,12 @@ int PID::get_parent_pid() {
 #endif
 }
 
-ThreadPool::ThreadPool(int max_num_threads) : max_num_threads(max_num_threads) {
+ThreadPool::ThreadPool(int max_num_threads,
+                       bool work_stealing,
+                       bool pin_threads)
+    : max_num_threads(max_num_threads),
+      pin_threads(pin_threads),
+      work_stealing(work_stealing) {
   exiting = false;
   started = false;
   running_threads = 0;
@@ -60,9 +143,21 @@ ThreadPool::ThreadPool(int max_num_threads) : max_num_threads(max_num_threads) {
   task_head = 0;
   task_tail = 0;
   thread_counter = 0;
+  launch_word = 0;
+  pending_threads = 0;
+  num_parked_threads = 0;
+  master_parked = false;
+  exiting_flag = false;
   threads.resize((std::size_t)max_num_threads);
-  for (int i = 0; i < max_num_threads; i++) {
-    threads[i] = std::thread([this] { this->target(); });
+  if (work_stealing) {
+    deques = std::make_unique<TaskDeque[]>(max_num_threads);
+    for (int i = 0; i < max_num_threads; i++) {
+      threads[i] = std::thread([this, i] { this->target_work_stealing(i); });
+    }
+  } else {
+    for (int i = 0; i < max_num_threads; i++) {
+      threads[i] = std::thread([this] { this->target(); });
+    }
   }
 }
 
@@ -70,6 +165,11 @@ void ThreadPool::run(int splits,
                      int desired_num_threads,
                      void *range_for_task_context,
                      RangeForTaskFunc *func) {
+  if (work_stealing) {
+    run_work_stealing(splits, desired_num_threads, range_for_task_context,
+                      func);
+    return;
+  }
   {
     std::lock_guard _(mutex);
     this->range_for_task_context = range_for_task_context;
@@ -101,6 +201,8 @@ void ThreadPool::target() {
     std::lock_guard<std::mutex> lock(mutex);
     thread_id = thread_counter++;
   }
+  if (pin_threads)
+    pin_current_thread(thread_id);
   while (true) {
     {
       std::unique_lock<std::mutex> lock(mutex);
@@ -151,10 +253,134 @@ void ThreadPool::target() {
   }
 }
 
+void ThreadPool::run_work_stealing(int splits,
+                                   int desired_num_threads,
+                                   void *range_for_task_context,
+                                   RangeForTaskFunc *func) {
+  if (splits <= 0)
+    return;
+  this->range_for_task_context = range_for_task_context;
+  this->func = func;
+  int num_threads = std::min({desired_num_threads, max_num_threads, splits});
+  TI_ASSERT(num_threads > 0);
+  // Initially, each thread owns a contiguous range of tasks
+  for (int i = 0; i < num_threads; i++) {
+    deques[i].range.store(
+        pack_range(uint32((int64)splits * i / num_threads),
+                   uint32((int64)splits * (i + 1) / num_threads)),
+        std::memory_order_relaxed);
+  }
+  pending_threads.store(num_threads, std::memory_order_relaxed);
+  timestamp++;
+  TI_ASSERT(timestamp < (1LL << 47));  // avoid overflowing here
+  // Publish the launch. Workers with thread_id >= num_threads skip it.
+  launch_word.store((timestamp << 16) | (uint64)num_threads);
+
+  if (num_parked_threads.load() > 0) {
+    std::lock_guard<std::mutex> _(mutex);
+    slave_cv.notify_all();
+  }
+
+  // Completion barrier: spin first, then park.
+  for (int i = 0; i < kNumSpinsBeforeParking; i++) {
+    if (pending_threads.load(std::memory_order_acquire) == 0)
+      return;
+    spin_pause(i);
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  master_parked.store(true);
+  master_cv.wait(lock, [this] { return pending_threads.load() == 0; });
+  master_parked.store(false);
+}
+
+void ThreadPool::target_work_stealing(int thread_id) {
+  if (pin_threads)
+    pin_current_thread(thread_id);
+  uint64 last_launch = 0;
+  while (true) {
+    uint64 launch = launch_word.load(std::memory_order_acquire);
+    int num_spins = 0;
+    while (launch == last_launch && !exiting_flag.load()) {
+      if (num_spins < kNumSpinsBeforeParking) {
+        spin_pause(num_spins++);
+      } else {
+        std::unique_lock<std::mutex> lock(mutex);
+        num_parked_threads++;
+        slave_cv.wait(lock, [&] {
+          return launch_word.load() != last_launch || exiting_flag.load();
+        });
+        num_parked_threads--;
+      }
+      launch = launch_word.load(std::memory_order_acquire);
+    }
+    if (exiting_flag.load())
+      break;
+    last_launch = launch;
+    int num_threads = int(launch & 0xFFFF);
+    if (thread_id >= num_threads)
+      continue;
+
+    execute_tasks(thread_id, num_threads);
+
+    if (pending_threads.fetch_sub(1) == 1 && master_parked.load()) {
+      // Taking the lock makes sure the master is waiting on master_cv.
+      std::lock_guard<std::mutex> _(mutex);
+      master_cv.notify_one();
+    }
+  }
+}
+
+void ThreadPool::execute_tasks(int thread_id, int num_threads) {
+  while (true) {
+    int task_id;
+    while (pop_task(thread_id, task_id)) {
+      func(range_for_task_context, thread_id, task_id);
+    }
+    if (!steal_tasks(thread_id, num_threads))
+      break;
+  }
+}
+
+bool ThreadPool::pop_task(int thread_id, int &task_id) {
+  auto &range = deques[thread_id].range;
+  uint64 old_range = range.load(std::memory_order_acquire);
+  while (true) {
+    auto begin = range_begin(old_range), end = range_end(old_range);
+    if (begin >= end)
+      return false;
+    if (range.compare_exchange_weak(old_range, pack_range(begin + 1, end))) {
+      task_id = (int)begin;
+      return true;
+    }
+  }
+}
+
+bool ThreadPool::steal_tasks(int thread_id, int num_threads) {
+  // Steal the back half of the first non-empty victim deque.
+  for (int k = 1; k < num_threads; k++) {
+    auto &victim = deques[(thread_id + k) % num_threads].range;
+    uint64 old_range = victim.load(std::memory_order_acquire);
+    while (true) {
+      auto begin = range_begin(old_range), end = range_end(old_range);
+      if (begin >= end)
+        break;
+      auto mid = end - (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(old_range, pack_range(begin, mid))) {
+        // Our own deque is empty, so no thief can be updating it now.
+        deques[thread_id].range.store(pack_range(mid, end),
+                                      std::memory_order_release);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 ThreadPool::~ThreadPool() {
   {
     std::lock_guard<std::mutex> lg(mutex);
     exiting = true;
+    exiting_flag = true;
   }
   slave_cv.notify_all();
   for (auto &th : threads)
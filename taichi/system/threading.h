@@ -10,6 +10,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <thread>
 
 TI_NAMESPACE_BEGIN
@@ -25,6 +26,13 @@ class PID {
 
 class ThreadPool {
  public:
+  // Task range [begin, end) of a worker, packed into a single 64-bit word so
+  // that the owner (popping from the front) and thieves (stealing from the
+  // back) can update it with a single CAS.
+  struct alignas(64) TaskDeque {
+    std::atomic<uint64> range{0};
+  };
+
   std::vector<std::thread> threads;
   std::condition_variable slave_cv;
   std::condition_variable master_cv;
@@ -45,7 +53,22 @@ class ThreadPool {
                                  // taichi::lang::Context.
   int thread_counter;
 
-  ThreadPool(int max_num_threads);
+  // Pin worker i to logical CPU i (modulo the number of CPUs)
+  bool pin_threads;
+
+  // Work-stealing scheduler states
+  bool work_stealing;
+  std::unique_ptr<TaskDeque[]> deques;
+  // (launch epoch << 16) | number of threads of this launch
+  std::atomic<uint64> launch_word;
+  std::atomic<int> pending_threads;
+  std::atomic<int> num_parked_threads;
+  std::atomic<bool> master_parked;
+  std::atomic<bool> exiting_flag;
+
+  ThreadPool(int max_num_threads,
+             bool work_stealing = false,
+             bool pin_threads = false);
 
   void run(int splits,
            int desired_num_threads,
@@ -63,6 +86,20 @@ class ThreadPool {
   void target();
 
   ~ThreadPool();
+
+ private:
+  void run_work_stealing(int splits,
+                         int desired_num_threads,
+                         void *range_for_task_context,
+                         RangeForTaskFunc *func);
+
+  void target_work_stealing(int thread_id);
+
+  void execute_tasks(int thread_id, int num_threads);
+
+  bool pop_task(int thread_id, int &task_id);
+
+  bool steal_tasks(int thread_id, int num_threads);
 };
 
 TI_NAMESPACE_END
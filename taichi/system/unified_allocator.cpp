@@ -11,7 +11,10 @@
 
 TLANG_NAMESPACE_BEGIN
 
-UnifiedAllocator::UnifiedAllocator(std::size_t size, Arch arch)
+UnifiedAllocator::UnifiedAllocator(std::size_t size,
+                                   Arch arch,
+                                   const std::string &numa_policy,
+                                   bool huge_pages)
     : size(size), arch_(arch) {
   auto t = Time::get_time();
   if (arch_ == Arch::cuda) {
@@ -51,7 +54,8 @@ UnifiedAllocator::UnifiedAllocator(std::size_t size, Arch arch)
   } else {
     TI_TRACE("Allocating virtual address space of size {} MB",
              size / 1024 / 1024);
-    cpu_vm = std::make_unique<VirtualMemoryAllocator>(size);
+    cpu_vm = std::make_unique<VirtualMemoryAllocator>(size, huge_pages);
+    cpu_vm->set_numa_policy(numa_policy);
     data = (uint8 *)cpu_vm->ptr;
   }
   TI_ASSERT(data != nullptr);
@@ -2,6 +2,7 @@
 #include <mutex>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "taichi/program/arch.h"
 
@@ -28,7 +29,12 @@ class UnifiedAllocator {
   std::mutex lock;
 
  public:
-  UnifiedAllocator(std::size_t size, Arch arch);
+  // |numa_policy| and |huge_pages| apply to CPU memory only. See
+  // VirtualMemoryAllocator.
+  UnifiedAllocator(std::size_t size,
+                   Arch arch,
+                   const std::string &numa_policy = "",
+                   bool huge_pages = false);
 
   ~UnifiedAllocator();
 
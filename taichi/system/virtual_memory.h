@@ -2,8 +2,17 @@
 
 #include "taichi/common/core.h"
 
+#include <fstream>
+#include <sstream>
+#include <string>
+
 #if defined(TI_PLATFORM_UNIX)
 #include <sys/mman.h>
+#if defined(TI_PLATFORM_LINUX)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #else
 #include "taichi/platform/windows/windows.h"
 #endif
@@ -14,16 +23,36 @@ TI_NAMESPACE_BEGIN
 class VirtualMemoryAllocator {
  public:
   static constexpr size_t page_size = (1 << 12);  // 4 KB page size by default
+  static constexpr size_t huge_page_size = (1 << 21);  // 2 MB
   void *ptr;
   size_t size;
-  explicit VirtualMemoryAllocator(size_t size) : size(size) {
+  // If |huge_pages| is true, the region is aligned to |huge_page_size| and
+  // the OS is asked to back it with transparent huge pages. Regular pages are
+  // used if that is not supported.
+  explicit VirtualMemoryAllocator(size_t size, bool huge_pages = false)
+      : size(size) {
 // http://pages.cs.wisc.edu/~sifakis/papers/SPGrid.pdf Sec 3.1
 #if defined(TI_PLATFORM_UNIX)
-    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+    // Over-allocate so that the region can be trimmed to a huge page boundary.
+    auto map_size = huge_pages ? size + huge_page_size : size;
+    ptr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
     TI_ERROR_IF(ptr == MAP_FAILED, "Virtual memory allocation ({} B) failed.",
                 size);
+    if (huge_pages) {
+      auto begin = (uint8 *)ptr;
+      auto aligned = (uint8 *)((uint64(begin) + huge_page_size - 1) /
+                               huge_page_size * huge_page_size);
+      auto end = aligned + (size + page_size - 1) / page_size * page_size;
+      if (aligned != begin)
+        munmap(begin, aligned - begin);
+      munmap(end, begin + map_size - end);
+      ptr = aligned;
+      enable_huge_pages();
+    }
 #else
+    if (huge_pages)
+      TI_WARN("Huge pages are only supported on Linux.");
     MEMORYSTATUSEX stat;
     stat.dwLength = sizeof(stat);
     GlobalMemoryStatusEx(&stat);
@@ -41,6 +70,105 @@ class VirtualMemoryAllocator {
                 page_size);
   }
 
+  // Advises the OS to back the region with transparent huge pages. Returns
+  // false (and keeps regular pages) if that is not supported.
+  bool enable_huge_pages() {
+#if defined(TI_PLATFORM_LINUX) && defined(MADV_HUGEPAGE)
+    if (madvise(ptr, size, MADV_HUGEPAGE) == 0)
+      return true;
+    TI_WARN(
+        "Transparent huge pages are unavailable. Falling back to {} B pages.",
+        page_size);
+#else
+    TI_WARN("Huge pages are only supported on Linux.");
+#endif
+    return false;
+  }
+
+  // Returns the pages fully inside [ptr, ptr + size) to the OS, keeping the
+  // address range reserved. The pages read as zero when touched again.
+  // On Windows the range is recommitted right away, since callers touch it
+  // again without notice. That frees the physical pages, but the commit
+  // charge of the process does not drop.
+  static void decommit(void *ptr, size_t size) {
+    auto begin = (uint64(ptr) + page_size - 1) / page_size * page_size;
+    auto end = (uint64(ptr) + size) / page_size * page_size;
+    if (begin >= end)
+      return;
+#if defined(TI_PLATFORM_LINUX)
+    // Unlike MADV_FREE, this drops the pages from RSS right away.
+    if (madvise((void *)begin, end - begin, MADV_DONTNEED) != 0)
+      TI_WARN("Failed to decommit {} B of memory", end - begin);
+#elif defined(TI_PLATFORM_UNIX)
+    // Elsewhere MADV_DONTNEED does not guarantee zero-filled pages. Replace
+    // the range with a fresh mapping instead.
+    if (mmap((void *)begin, end - begin, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1,
+             0) == MAP_FAILED)
+      TI_WARN("Failed to decommit {} B of memory", end - begin);
+#else
+    if (!VirtualFree((void *)begin, end - begin, MEM_DECOMMIT) ||
+        !VirtualAlloc((void *)begin, end - begin, MEM_COMMIT, PAGE_READWRITE))
+      TI_WARN("Failed to decommit {} B of memory", end - begin);
+#endif
+  }
+
+  // Sets the NUMA memory policy of the whole region. Must be called before the
+  // region is touched. |policy| is one of
+  //   "first_touch": the OS default, pages live on the node that first writes
+  //                  them;
+  //   "interleave":  pages are spread round-robin over all online nodes;
+  //   "bind:<n>":    pages are allocated on node <n>.
+  // Only supported on Linux. Failures are reported as warnings.
+  void set_numa_policy(const std::string &policy) {
+    if (policy.empty() || policy == "first_touch")
+      return;
+#if defined(TI_PLATFORM_LINUX)
+    int mode;
+    uint64 nodes;
+    if (policy == "interleave") {
+      mode = MPOL_INTERLEAVE;
+      nodes = get_online_numa_nodes();
+    } else if (policy.rfind("bind:", 0) == 0) {
+      mode = MPOL_BIND;
+      auto node = std::stoi(policy.substr(5));
+      TI_ERROR_IF(node < 0 || node >= 64, "Invalid NUMA node {}", node);
+      nodes = uint64(1) << node;
+    } else {
+      TI_ERROR("Unknown NUMA memory policy \"{}\"", policy);
+    }
+    // The kernel reads |maxnode - 1| bits of the node mask.
+    if (syscall(SYS_mbind, ptr, size, mode, &nodes, sizeof(nodes) * 8 + 1,
+                0) != 0) {
+      TI_WARN("Failed to set NUMA memory policy \"{}\"", policy);
+    }
+#else
+    TI_WARN("NUMA memory policies are only supported on Linux.");
+#endif
+  }
+
+#if defined(TI_PLATFORM_LINUX)
+  // Returns the bit mask of online NUMA nodes, e.g. 0b11 for "0-1".
+  static uint64 get_online_numa_nodes() {
+    std::ifstream fin("/sys/devices/system/node/online");
+    std::string online;
+    uint64 nodes = 0;
+    if (fin >> online) {
+      std::stringstream ss(online);
+      std::string range;
+      while (std::getline(ss, range, ',')) {
+        auto dash = range.find('-');
+        int begin = std::stoi(range.substr(0, dash));
+        int end = dash == std::string::npos ? begin
+                                            : std::stoi(range.substr(dash + 1));
+        for (int i = begin; i <= end && i < 64; i++)
+          nodes |= uint64(1) << i;
+      }
+    }
+    return nodes ? nodes : 1;
+  }
+#endif
+
   ~VirtualMemoryAllocator() {
 #if defined(TI_PLATFORM_UNIX)
     if (munmap(ptr, size) != 0)
@@ -186,24 +186,67 @@ class ReplaceLocalVarWithStacks : public BasicStmtVisitor {
  public:
   using BasicStmtVisitor::visit;
 
+  // Returns the number of times |stmt| runs per execution of |scope|, or -1
+  // if it is not known at compile time.
+  static int64 max_num_executions(Stmt *stmt, Block *scope) {
+    // Above this, a static size is no better than the default one.
+    constexpr int64 limit = 1LL << 32;
+    int64 result = 1;
+    for (auto block = stmt->parent; block != scope;) {
+      auto loop = block->parent_stmt;
+      if (loop == nullptr)
+        return -1;
+      if (auto range_for = loop->cast<RangeForStmt>()) {
+        auto begin = range_for->begin->cast<ConstStmt>();
+        auto end = range_for->end->cast<ConstStmt>();
+        if (!begin || !end)
+          return -1;
+        auto trip_count = std::max(
+            (int64)end->val[0].val_int() - begin->val[0].val_int(), (int64)0);
+        result *= trip_count;
+        if (result > limit)
+          return -1;
+      } else if (loop->is<WhileStmt>() || loop->is<StructForStmt>() ||
+                 loop->is<OffloadedStmt>()) {
+        return -1;
+      }
+      // Otherwise |loop| is an IfStmt, which runs its blocks at most once.
+      block = loop->parent;
+    }
+    return result;
+  }
+
   void visit(AllocaStmt *alloc) override {
     TI_ASSERT(alloc->width() == 1);
-    bool load_only = irpass::analysis::gather_statements(
-                         alloc->parent,
-                         [&](Stmt *s) {
-                           if (auto store = s->cast<LocalStoreStmt>())
-                             return store->ptr == alloc;
-                           else if (auto atomic = s->cast<AtomicOpStmt>()) {
-                             return atomic->dest == alloc;
-                           } else {
-                             return false;
-                           }
-                         })
-                         .empty();
-    if (!load_only) {
+    auto stores = irpass::analysis::gather_statements(
+        alloc->parent, [&](Stmt *s) {
+          if (auto store = s->cast<LocalStoreStmt>())
+            return store->ptr == alloc;
+          else if (auto atomic = s->cast<AtomicOpStmt>()) {
+            return atomic->dest == alloc;
+          } else {
+            return false;
+          }
+        });
+    if (!stores.empty()) {
       auto dtype = alloc->ret_type;
-      auto stack_alloca = Stmt::make<StackAllocaStmt>(
-          dtype, alloc->get_kernel()->program.config.ad_stack_size);
+      // Size the stack to the number of pushes (one per store plus the
+      // initial zero) when the trip counts of the enclosing loops are known.
+      // Otherwise fall back to ad_stack_size; the LLVM backends spill
+      // overflowing entries to the heap anyway.
+      std::size_t max_size = alloc->get_kernel()->program.config.ad_stack_size;
+      int64 num_pushes = 1;
+      for (auto store : stores) {
+        auto n = max_num_executions(store, alloc->parent);
+        if (n == -1) {
+          num_pushes = -1;
+          break;
+        }
+        num_pushes += n;
+      }
+      if (num_pushes != -1)
+        max_size = std::min(max_size, (std::size_t)num_pushes);
+      auto stack_alloca = Stmt::make<StackAllocaStmt>(dtype, max_size);
       auto stack_alloca_ptr = stack_alloca.get();
 
       alloc->replace_with(std::move(stack_alloca));
@@ -56,6 +56,21 @@ void convert_to_range_for(OffloadedStmt *offloaded) {
     for (int j = 0; j < (int)physical_indices.size(); j++) {
       auto p = physical_indices[j];
       auto ext = snode->extractors[p];
+      if (snode->_morton) {
+        // Gather the interleaved bits of index p one by one
+        for (int b = 0; b < ext.num_bits; b++) {
+          auto bit_pos = offset + snode->morton_bit_position(p, b);
+          Stmt *delta = body_header.push_back<BitExtractStmt>(
+              main_loop_var, bit_pos, bit_pos + 1);
+          auto multiplier = body_header.push_back<ConstStmt>(
+              TypedConstant(1 << (ext.start + b)));
+          delta = body_header.push_back<BinaryOpStmt>(BinaryOpType::mul,
+                                                      delta, multiplier);
+          new_loop_vars[j] = body_header.push_back<BinaryOpStmt>(
+              BinaryOpType::add, new_loop_vars[j], delta);
+        }
+        continue;
+      }
       Stmt *delta = body_header.push_back<BitExtractStmt>(
           main_loop_var, ext.acc_offset + offset,
           ext.acc_offset + offset + ext.num_bits);
@@ -57,6 +57,32 @@ class LowerAccess : public IRVisitor {
     current_struct_for = nullptr;
   }
 
+  // Interleaves the bits of |indices| that belong to |snode| into its Morton
+  // (Z-order) element index.
+  Stmt *linearize_morton(VecStatement &lowered,
+                         SNode *snode,
+                         const std::vector<Stmt *> &indices) {
+    Stmt *linearized = lowered.push_back<ConstStmt>(TypedConstant(0));
+    for (int k_ = 0; k_ < (int)indices.size(); k_++) {
+      int k = snode->physical_index_position[k_];
+      auto &extractor = snode->extractors[k];
+      for (int b = 0; b < extractor.num_bits; b++) {
+        auto bit = lowered.push_back<BitExtractStmt>(
+            indices[k_], extractor.start + b, extractor.start + b + 1);
+        bit->ret_type = PrimitiveType::i32;
+        auto weight = lowered.push_back<ConstStmt>(
+            TypedConstant(1 << snode->morton_bit_position(k, b)));
+        auto term =
+            lowered.push_back<BinaryOpStmt>(BinaryOpType::mul, bit, weight);
+        term->ret_type = PrimitiveType::i32;
+        linearized = lowered.push_back<BinaryOpStmt>(BinaryOpType::add,
+                                                     linearized, term);
+        linearized->ret_type = PrimitiveType::i32;
+      }
+    }
+    return linearized;
+  }
+
   void lower_scalar_ptr(VecStatement &lowered,
                         SNode *leaf_snode,
                         std::vector<Stmt *> indices,
@@ -91,21 +117,28 @@ class LowerAccess : public IRVisitor {
           i == length - 1 && snodes[i - 1]->type == SNodeType::dense) {
         continue;
       }
-      std::vector<Stmt *> lowered_indices;
-      std::vector<int> strides;
-      // extract bits
-      for (int k_ = 0; k_ < (int)indices.size(); k_++) {
-        for (int k = 0; k < taichi_max_num_indices; k++) {
-          if (snode->physical_index_position[k_] == k) {
-            int begin = snode->extractors[k].start;
-            int end = begin + snode->extractors[k].num_bits;
-            auto extracted =
-                Stmt::make<BitExtractStmt>(indices[k_], begin, end);
-            lowered_indices.push_back(extracted.get());
-            lowered.push_back(std::move(extracted));
-            strides.push_back(1 << snode->extractors[k].num_bits);
+      Stmt *linearized = nullptr;
+      if (snode->_morton) {
+        linearized = linearize_morton(lowered, snode, indices);
+      } else {
+        std::vector<Stmt *> lowered_indices;
+        std::vector<int> strides;
+        // extract bits
+        for (int k_ = 0; k_ < (int)indices.size(); k_++) {
+          for (int k = 0; k < taichi_max_num_indices; k++) {
+            if (snode->physical_index_position[k_] == k) {
+              int begin = snode->extractors[k].start;
+              int end = begin + snode->extractors[k].num_bits;
+              auto extracted =
+                  Stmt::make<BitExtractStmt>(indices[k_], begin, end);
+              lowered_indices.push_back(extracted.get());
+              lowered.push_back(std::move(extracted));
+              strides.push_back(1 << snode->extractors[k].num_bits);
+            }
           }
         }
+        // linearize
+        linearized = lowered.push_back<LinearizeStmt>(lowered_indices, strides);
       }
 
       bool on_loop_tree = nodes_on_loop.find(snode) != nodes_on_loop.end();
@@ -129,10 +162,6 @@ class LowerAccess : public IRVisitor {
         }
       }
 
-      // linearize
-      auto linearized =
-          lowered.push_back<LinearizeStmt>(lowered_indices, strides);
-
       if (snode_op != SNodeOpType::undefined && i == (int)snodes.size() - 1) {
         // Create a SNodeOp querying if element i(linearized) of node is active
         lowered.push_back<SNodeOpStmt>(snode_op, snodes[i], last, linearized);
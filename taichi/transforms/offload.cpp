@@ -144,6 +144,8 @@ class Offloader {
             std::min(snode_child->max_num_elements(),
                      (int64)std::min(program->default_block_dim(),
                                      program->config.max_block_dim));
+        offloaded_listgen->num_cpu_threads = std::min(
+            for_stmt->parallelize, program->config.cpu_max_num_threads);
         root_block->insert(std::move(offloaded_listgen));
       }
     }
@@ -0,0 +1,60 @@
+#include "taichi/util/testing.h"
+#include "taichi/program/cpu_autotuner.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+TLANG_NAMESPACE_BEGIN
+
+TI_TEST("cpu_autotuner") {
+  const std::string task = "test_kernel_c0_0_kernel_0_range_for";
+  CPUAutotuner tuner(/*trials=*/2);
+  Context context{};
+  // Candidates: 5 block_dims x 2 thread counts
+  const int num_trials = 2 * 10;
+  int num_wrong_threads = 0;
+  for (int i = 0; i < num_trials; i++) {
+    CHECK(tuner.get_choice(task) == nullptr);
+    tuner.launch(task, CPUAutotuner::TaskKind::range_for, /*num_threads=*/8,
+                 &context, [&] {
+                   if (context.cpu_num_threads != 0 &&
+                       context.cpu_num_threads != 4)
+                     num_wrong_threads++;
+                   if (context.cpu_block_dim != 512 ||
+                       context.cpu_num_threads != 4) {
+                     std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                   }
+                 });
+    // The overrides only last for the launch
+    CHECK(context.cpu_block_dim == 0);
+    CHECK(context.cpu_num_threads == 0);
+  }
+  CHECK(num_wrong_threads == 0);
+  auto choice = tuner.get_choice(task);
+  REQUIRE(choice != nullptr);
+  CHECK(choice->block_dim == 512);
+  CHECK(choice->num_threads == 4);
+
+  // Settled tasks keep their choice
+  tuner.launch(task, CPUAutotuner::TaskKind::range_for, 8, &context, [&] {
+    CHECK(context.cpu_block_dim == 512);
+    CHECK(context.cpu_num_threads == 4);
+  });
+
+  auto filename = (std::filesystem::temp_directory_path() /
+                   "taichi_test_cpu_autotuner.json")
+                      .string();
+  tuner.save(filename);
+  CPUAutotuner loaded(2);
+  loaded.load(filename);
+  std::remove(filename.c_str());
+  choice = loaded.get_choice(task);
+  REQUIRE(choice != nullptr);
+  CHECK(choice->block_dim == 512);
+  CHECK(choice->element_split == 0);
+  CHECK(choice->num_threads == 4);
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,53 @@
+#include "taichi/util/testing.h"
+#include "taichi/system/threading.h"
+
+#include <atomic>
+#include <vector>
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+struct CountingContext {
+  std::atomic<int> *counters;
+};
+
+void count_task(void *context, int thread_id, int task_id) {
+  ((CountingContext *)context)->counters[task_id]++;
+}
+
+void test_every_task_runs_once(bool work_stealing, bool pin_threads = false) {
+  const int max_num_threads = 8;
+  const int max_splits = 1000;
+  ThreadPool pool(max_num_threads, work_stealing, pin_threads);
+  std::vector<std::atomic<int>> counters(max_splits);
+  CountingContext context{counters.data()};
+  for (int iter = 0; iter < 100; iter++) {
+    int splits = (iter * 37) % max_splits + 1;
+    int num_threads = iter % (max_num_threads + 1) + 1;
+    for (int i = 0; i < splits; i++) {
+      counters[i] = 0;
+    }
+    pool.run(splits, num_threads, &context, count_task);
+    for (int i = 0; i < splits; i++) {
+      CHECK(counters[i] == 1);
+    }
+  }
+}
+
+}  // namespace
+
+TI_TEST("thread_pool") {
+  SECTION("default") {
+    test_every_task_runs_once(false);
+  }
+  SECTION("work_stealing") {
+    test_every_task_runs_once(true);
+  }
+  SECTION("pinned") {
+    test_every_task_runs_once(false, true);
+    test_every_task_runs_once(true, true);
+  }
+}
+
+TI_NAMESPACE_END
@@ -0,0 +1,36 @@
+#include "taichi/util/testing.h"
+#include "taichi/system/virtual_memory.h"
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+void test_region(std::size_t size, bool huge_pages) {
+  VirtualMemoryAllocator vm(size, huge_pages);
+  auto alignment = huge_pages ? VirtualMemoryAllocator::huge_page_size
+                              : VirtualMemoryAllocator::page_size;
+  CHECK(uint64(vm.ptr) % alignment == 0);
+  // The whole region is usable and zero-filled
+  auto data = (uint8 *)vm.ptr;
+  for (std::size_t i = 0; i < size; i += VirtualMemoryAllocator::page_size) {
+    CHECK(data[i] == 0);
+    data[i] = 1;
+  }
+  CHECK(data[size - 1] == 0);
+  data[size - 1] = 1;
+}
+
+}  // namespace
+
+TI_TEST("virtual_memory") {
+  SECTION("regular_pages") {
+    test_region(1 << 20, false);
+  }
+  SECTION("huge_pages") {
+    test_region(16 << 20, true);
+    // Sizes that are not multiples of the page size
+    test_region((3 << 21) + 12345, true);
+  }
+}
+
+TI_NAMESPACE_END
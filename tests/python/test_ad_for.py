@@ -364,3 +364,36 @@ def test_complex_body():
 
     for i in range(N):
         assert a.grad[i] == g[i]
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], ad_stack_size=4)
+def test_ad_stack_spill():
+    N = 10
+    a = ti.field(ti.f32, shape=N, needs_grad=True)
+    b = ti.field(ti.i32, shape=N)
+    p = ti.field(ti.f32, shape=N, needs_grad=True)
+
+    @ti.kernel
+    def compute():
+        for i in range(N):
+            ret = 1.0
+            # Far more iterations than the stack holds inline
+            for j in range(b[i]):
+                ret = ret * 0.999 + a[i]
+            p[i] = ret
+
+    for i in range(N):
+        a[i] = 1
+        b[i] = 1000 * i
+
+    compute()
+
+    for i in range(N):
+        p.grad[i] = 1
+
+    compute.grad()
+
+    for i in range(N):
+        # d(p)/d(a) = sum_{k < b} 0.999^k
+        expected = (1 - 0.999**b[i]) / (1 - 0.999)
+        assert a.grad[i] == ti.approx(expected, rel=1e-3)
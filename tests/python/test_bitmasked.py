@@ -242,3 +242,31 @@ def test_bitmasked_offset_child():
 
     func()
     assert s[None] == 7
+
+
+@archs_support_bitmasked
+def test_bitmasked_sparse_runs():
+    x = ti.field(ti.i32)
+    c = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 4096
+    ti.root.bitmasked(ti.i, n).place(x)
+    ti.root.place(c, s)
+
+    # Cells at and around mask word boundaries, plus a run spanning words
+    cells = [0, 31, 32, 33, 63, 64, 1000, 4094, 4095]
+    cells += list(range(200, 300))
+
+    @ti.kernel
+    def func():
+        for i in x:
+            c[None] += 1
+            s[None] += i
+
+    for i in cells:
+        x[i] = 1
+
+    func()
+    assert c[None] == len(cells)
+    assert s[None] == sum(cells)
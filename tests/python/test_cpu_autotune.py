@@ -0,0 +1,84 @@
+import os
+import tempfile
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, cpu_autotune=True)
+def test_cpu_autotune_results():
+    n = 100000
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+    ti.root.pointer(ti.i, n // 64).dense(ti.i, 64).place(y)
+
+    @ti.kernel
+    def fill(k: ti.i32):
+        for i in x:
+            x[i] = i + k
+        for i in range(0, n, 3):
+            y[i] = 1
+
+    @ti.kernel
+    def count():
+        for i in y:
+            s[None] += y[i]
+
+    # Enough launches to go through all candidates and settle
+    for k in range(50):
+        fill(k)
+        s[None] = 0
+        count()
+        assert x[n - 1] == n - 1 + k
+        assert s[None] == (n + 2) // 3
+
+
+def test_cpu_autotune_file():
+    filename = os.path.join(tempfile.mkdtemp(), 'autotune.json')
+    ti.init(arch=ti.cpu, cpu_autotune=True, cpu_autotune_file=filename)
+    x = ti.field(ti.f32, shape=1024)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    for _ in range(50):
+        fill()
+    ti.reset()
+
+    with open(filename) as f:
+        content = f.read()
+    assert 'fill' in content
+    assert 'block_dim' in content
+    os.remove(filename)
+
+
+def test_cpu_autotune_file_reuse():
+    filename = os.path.join(tempfile.mkdtemp(), 'autotune.json')
+
+    def run(scale):
+        ti.init(arch=ti.cpu, cpu_autotune=True, cpu_autotune_file=filename)
+        x = ti.field(ti.f32, shape=1024)
+
+        # Redefined each run, so the Python kernel counter differs
+        @ti.kernel
+        def fill():
+            for i in x:
+                x[i] = i * scale
+
+        for _ in range(50):
+            fill()
+        assert x[1000] == 1000 * scale
+        counters = ti.get_kernel_stats().get_counters()
+        trial_launches = counters.get('cpu_autotune_trial_launches', 0)
+        ti.reset()
+        return trial_launches
+
+    # The first run tunes the task and saves its choice
+    assert run(1) > 0
+    # The second run loads the choice and launches with it right away
+    assert run(1) == 0
+    # A different kernel of the same name is tuned on its own
+    assert run(2) > 0
+    os.remove(filename)
@@ -0,0 +1,44 @@
+import platform
+
+import pytest
+
+import taichi as ti
+
+
+def run_saxpy(**kwargs):
+    ti.init(arch=ti.cpu, **kwargs)
+    n = 1000
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def saxpy():
+        for i in x:
+            x[i] = i
+            y[i] = 2 * x[i] + 1
+
+    saxpy()
+    ret = y.to_numpy()
+    ti.reset()
+    return ret
+
+
+@pytest.mark.skipif(platform.machine() not in ['x86_64', 'AMD64'],
+                    reason='x86-64 CPU names')
+def test_cpu_target():
+    expected = run_saxpy()
+    assert (run_saxpy(cpu_target='x86-64') == expected).all()
+    assert (run_saxpy(cpu_target='haswell',
+                      cpu_features='-avx2') == expected).all()
+    # Unknown targets fall back to the host CPU
+    assert (run_saxpy(cpu_target='no-such-cpu') == expected).all()
+
+
+@pytest.mark.skipif(platform.machine() not in ['x86_64', 'AMD64'],
+                    reason='x86-64 CPU names')
+def test_cpu_multiversioning():
+    expected = run_saxpy()
+    # Whether or not the host has AVX-512, the results are the same
+    assert (run_saxpy(cpu_target='x86-64',
+                      cpu_multiversioning_target='skylake-avx512') == expected
+            ).all()
@@ -208,3 +208,50 @@ def test_dynamic_activate():
     assert l[0] == m
     assert l[1] == 21
     assert l[2] == 21
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_dynamic_many_chunks():
+    x = ti.field(ti.i32)
+    n = 1 << 20
+    m = 100000
+
+    # 2^16 chunks, indexed by the two-level chunk directory
+    xp = ti.root.dynamic(ti.i, n, 16)
+    xp.place(x)
+
+    @ti.kernel
+    def append():
+        for i in range(m):
+            ti.append(xp, [], 1)
+
+    @ti.kernel
+    def scatter():
+        for i in range(1000):
+            x[(i * 7919) % n] = 2
+
+    @ti.kernel
+    def length() -> ti.i32:
+        return ti.length(xp, [])
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    append()
+    assert length() == m
+    assert total() == m
+
+    # Activating beyond the tail allocates all the chunks in between
+    scatter()
+    hits = set((i * 7919) % n for i in range(1000))
+    assert length() == max(hits) + 1
+    assert total() == m + sum(1 if j < m else 2 for j in hits)
+
+    xp.deactivate_all()
+    assert length() == 0
+    append()
+    assert total() == m
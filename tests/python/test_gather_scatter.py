@@ -0,0 +1,61 @@
+import taichi as ti
+import numpy as np
+
+
+@ti.all_archs
+def test_gather_scatter_1d():
+    x = ti.field(ti.i32, shape=16)
+
+    x.scatter([3, 5, 7], [30, 50, 70])
+    assert x[3] == 30
+    assert x[5] == 50
+    assert x[7] == 70
+    assert x[4] == 0
+
+    assert (x.gather([7, 3, 3, 0]) == [70, 30, 30, 0]).all()
+
+
+@ti.all_archs
+def test_gather_scatter_2d():
+    n = 32
+    x = ti.field(ti.f32, shape=(n, n))
+
+    indices = np.array([[i, (i * 7) % n] for i in range(n)])
+    values = np.arange(n, dtype=np.float32) * 0.5
+    x.scatter(indices, values)
+
+    expected = np.zeros((n, n), dtype=np.float32)
+    expected[indices[:, 0], indices[:, 1]] = values
+    assert np.allclose(x.to_numpy(), expected)
+    assert np.allclose(x.gather(indices), values)
+
+
+@ti.all_archs
+def test_gather_scatter_sparse():
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, 8).dense(ti.i, 4).place(x)
+
+    x.scatter([1, 17], [1.5, 2.5])
+    assert np.allclose(x.gather([0, 1, 17, 30]), [0, 1.5, 2.5, 0])
+
+
+@ti.all_archs
+def test_gather_scatter_vector():
+    v = ti.Vector.field(3, dtype=ti.f32, shape=(4, 4))
+
+    indices = [[0, 1], [2, 3]]
+    values = [[1, 2, 3], [4, 5, 6]]
+    v.scatter(indices, values)
+    assert v[2, 3][1] == 5
+    assert np.allclose(v.gather(indices), values)
+    assert v.gather(indices, keep_dims=True).shape == (2, 3, 1)
+
+
+@ti.all_archs
+def test_gather_scatter_matrix():
+    m = ti.Matrix.field(2, 2, dtype=ti.i32, shape=8)
+
+    values = np.arange(12, dtype=np.int32).reshape(3, 2, 2)
+    m.scatter([1, 2, 6], values)
+    assert m[6][1, 0] == 10
+    assert (m.gather([6, 1]) == values[[2, 0]]).all()
@@ -96,6 +96,179 @@ def test_pointer_gc():
         assert L.num_dynamically_allocated == 1
 
 
+def _test_pointer_gc_many_nodes():
+    x = ti.field(dtype=ti.i32)
+    n = 128
+
+    L = ti.root.pointer(ti.ij, n)
+    L.dense(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def fill(c: ti.i32):
+        for i, j in ti.ndrange(n * 4, n * 4):
+            x[i, j] = c
+
+    @ti.kernel
+    def activate_and_sum() -> ti.i32:
+        s = 0
+        for i, j in ti.ndrange(n, n):
+            ti.activate(L, [i, j])
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    for c in range(3):
+        fill(c + 1)
+        L.deactivate_all()
+
+    # Recycled nodes must be zero-filled before reuse.
+    assert activate_and_sum() == 0
+    assert L.num_dynamically_allocated == n * n
+
+
+@ti.test(require=ti.extension.sparse)
+def test_pointer_gc_many_nodes():
+    _test_pointer_gc_many_nodes()
+
+
+@ti.test(require=ti.extension.sparse, cpu_max_num_threads=1)
+def test_pointer_gc_many_nodes_serial():
+    _test_pointer_gc_many_nodes()
+
+
+@ti.test(require=ti.extension.sparse, arch=ti.cpu, cpu_alloc_magazines=True)
+def test_pointer_gc_magazines():
+    x = ti.field(dtype=ti.i32)
+    n = 128
+
+    L = ti.root.pointer(ti.ij, n)
+    L.dense(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def fill(c: ti.i32):
+        for i, j in ti.ndrange(n * 4, n * 4):
+            x[i, j] = c
+
+    @ti.kernel
+    def activate_and_sum() -> ti.i32:
+        s = 0
+        for i, j in ti.ndrange(n, n):
+            ti.activate(L, [i, j])
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    for c in range(3):
+        fill(c + 1)
+        L.deactivate_all()
+
+    # Nodes handed out from per-thread magazines must be zero-filled, too.
+    assert activate_and_sum() == 0
+    # Nodes parked in magazines also count as allocated.
+    assert L.num_dynamically_allocated >= n * n
+
+
+@ti.test(require=ti.extension.sparse, arch=ti.cpu, gc_decommit=True)
+def test_pointer_gc_decommit():
+    x = ti.field(dtype=ti.i32)
+    n = 512
+
+    L = ti.root.pointer(ti.ij, n)
+    L.dense(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def fill(c: ti.i32):
+        for i, j in ti.ndrange(n * 4, n * 4):
+            x[i, j] = c
+
+    @ti.kernel
+    def activate_and_sum() -> ti.i32:
+        s = 0
+        for i, j in ti.ndrange(n, n):
+            ti.activate(L, [i, j])
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    prog = ti.get_runtime().prog
+    fill(1)
+    assert prog.get_committed_memory_bytes() == prog.get_reserved_memory_bytes()
+    L.deactivate_all()
+    # All nodes are free, so their chunks are returned to the OS
+    decommitted = (prog.get_reserved_memory_bytes() -
+                   prog.get_committed_memory_bytes())
+    assert decommitted >= n * n * 4 * 4 * 4
+
+    # Decommitted nodes read as zero when reused
+    assert activate_and_sum() == 0
+    fill(2)
+    L.deactivate_all()
+    assert activate_and_sum() == 0
+
+
+@ti.test(require=ti.extension.sparse, gc_zero_fill=False)
+def test_pointer_gc_no_zero_fill():
+    x = ti.field(dtype=ti.i32)
+    n = 128
+
+    L = ti.root.pointer(ti.ij, n)
+    L.dense(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def fill(c: ti.i32):
+        for i, j in ti.ndrange(n * 4, n * 4):
+            x[i, j] = c
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n, n):
+            ti.activate(L, [i, j])
+
+    @ti.kernel
+    def sum() -> ti.i32:
+        s = 0
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    for c in range(3):
+        fill(c + 1)
+        assert sum() == (c + 1) * (n * 4)**2
+        L.deactivate_all()
+    assert L.num_dynamically_allocated == n * n
+    # Reactivated without a write, the recycled nodes keep their stale values
+    activate()
+    assert sum() == 3 * (n * 4)**2
+
+
+@ti.test(arch=ti.cpu, gc_zero_fill=False, cpu_max_num_threads=1)
+def test_pointer_gc_no_zero_fill_serial():
+    x = ti.field(dtype=ti.i32)
+    n = 16
+
+    L = ti.root.pointer(ti.ij, n)
+    L.dense(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def fill(c: ti.i32):
+        for i, j in ti.ndrange(n * 4, n * 4):
+            x[i, j] = c
+
+    @ti.kernel
+    def activate_and_sum() -> ti.i32:
+        s = 0
+        for i, j in ti.ndrange(n, n):
+            ti.activate(L, [i, j])
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    fill(7)
+    L.deactivate_all()
+    # The serial GC must not zero-fill the recycled nodes either
+    assert activate_and_sum() == 7 * (n * 4)**2
+
+
 @ti.test(require=[ti.extension.sparse, ti.extension.async_mode],
          async_mode=True)
 def test_fuse_allocator_state():
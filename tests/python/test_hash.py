@@ -0,0 +1,174 @@
+import time
+
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_struct_for():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 1024
+    ti.root.hash(ti.ij, n).dense(ti.ij, 8).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(100):
+            x[i * 73, i * 31] = i
+
+    @ti.kernel
+    def count():
+        for i, j in x:
+            s[None] += 1
+
+    activate()
+    count()
+    # Each touched cell activates a full 8x8 block
+    assert s[None] == 100 * 64
+    for i in range(100):
+        assert x[i * 73, i * 31] == i
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_leaf():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    ti.root.hash(ti.i, 1 << 20, capacity=256).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(100):
+            x[i * 9973] = i + 1
+
+    @ti.kernel
+    def sum():
+        for i in x:
+            s[None] += x[i]
+
+    activate()
+    sum()
+    assert s[None] == 100 * 101 // 2
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_is_active_deactivate():
+    x = ti.field(ti.f32)
+    s = ti.field(ti.i32)
+
+    n = 4096
+    ti.root.hash(ti.i, n).dense(ti.i, 4).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(n):
+            if i % 3 == 0:
+                x[i * 4] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in range(n):
+            if i % 2 == 0:
+                ti.deactivate(x.parent().parent(), i)
+
+    @ti.kernel
+    def count_active():
+        for i in range(n):
+            s[None] += ti.is_active(x.parent().parent(), i)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += 1
+
+    activate()
+    count_active()
+    assert s[None] == (n + 2) // 3
+    deactivate()
+    s[None] = 0
+    count_active()
+    assert s[None] == n // 6 + (n % 6 > 3)
+    s[None] = 0
+    count()
+    assert s[None] == 4 * (n // 6 + (n % 6 > 3))
+
+    # Reactivating a deactivated cell reuses its slot
+    activate()
+    s[None] = 0
+    count_active()
+    assert s[None] == (n + 2) // 3
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_reuse_slots():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    capacity = 256
+    block = ti.root.hash(ti.i, 1 << 24, capacity=capacity)
+    block.dense(ti.i, 4).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate(step: ti.i32):
+        for i in range(capacity // 2):
+            x[(step * capacity + i) * 4] = step + 1
+
+    @ti.kernel
+    def sum():
+        for i in x:
+            s[None] += x[i]
+
+    # Sweep far more distinct cells than |capacity| through the table, like
+    # particles moving over an unbounded domain.
+    for step in range(64):
+        activate(step)
+        s[None] = 0
+        sum()
+        assert s[None] == (step + 1) * capacity // 2
+        block.deactivate_all()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_reclaim_tombstones():
+    x = ti.field(ti.i32)
+
+    capacity = 1 << 16
+    window = capacity // 2
+    block = ti.root.hash(ti.i, 1 << 30, capacity=capacity)
+    block.place(x)
+
+    @ti.kernel
+    def activate(step: ti.i32):
+        for i in range(window):
+            x[step * window + i] = 1
+
+    @ti.kernel
+    def deactivate(step: ti.i32):
+        for i in range(window):
+            ti.deactivate(block, step * window + i)
+
+    @ti.kernel
+    def count_misses() -> ti.i32:
+        s = 0
+        for i in range(capacity):
+            s += 1 - ti.is_active(block, (1 << 29) + i)
+        return s
+
+    def time_misses():
+        t = time.time()
+        assert count_misses() == capacity
+        return time.time() - t
+
+    # Move a window of active cells over 64 x |capacity| distinct keys
+    activate(0)
+    count_misses()
+    t0 = time_misses()
+    for step in range(1, 128):
+        activate(step)
+        deactivate(step - 1)
+    # Without rebuilding the table, each miss would probe all slots by now
+    assert time_misses() < 10 * t0 + 0.1
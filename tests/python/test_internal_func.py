@@ -42,6 +42,15 @@ def test_list_manager():
     test()
 
 
+@all_archs_for_this
+def test_list_manager_i64():
+    @ti.kernel
+    def test():
+        ti.call_internal("test_list_manager_i64")
+
+    test()
+
+
 @all_archs_for_this
 def test_node_manager():
     @ti.kernel
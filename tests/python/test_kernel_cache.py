@@ -0,0 +1,91 @@
+import os
+import shutil
+import tempfile
+
+import taichi as ti
+
+
+def test_kernel_cache():
+    path = tempfile.mkdtemp()
+
+    @ti.kernel
+    def fill(x: ti.template(), k: ti.i32):
+        for i in x:
+            x[i] = i * k
+
+    def run():
+        ti.init(arch=ti.cpu, kernel_cache=True, kernel_cache_path=path)
+        x = ti.field(ti.i32, shape=128)
+        fill(x, 3)
+        assert x[100] == 300
+        prog = ti.get_runtime().prog
+        hits = prog.get_kernel_cache_hits()
+        misses = prog.get_kernel_cache_misses()
+        ti.reset()
+        return hits, misses
+
+    # The first run compiles and stores the runtime and the kernel
+    hits, misses = run()
+    assert hits == 0 and misses >= 2
+    assert any(f.endswith('.o') for f in os.listdir(path))
+    # The second run loads both
+    hits, misses = run()
+    assert hits >= 2
+
+    shutil.rmtree(path)
+
+
+def test_kernel_cache_parallel_compile():
+    path = tempfile.mkdtemp()
+
+    @ti.kernel
+    def multi_offload(x: ti.template(), y: ti.template()):
+        for i in x:
+            x[i] = i
+        for i in y:
+            y[i] = x[i] * 2
+        for i in x:
+            x[i] += y[i]
+
+    def run():
+        ti.init(arch=ti.cpu,
+                kernel_cache=True,
+                kernel_cache_path=path,
+                num_compile_threads=4)
+        x = ti.field(ti.i32, shape=128)
+        y = ti.field(ti.i32, shape=128)
+        multi_offload(x, y)
+        assert x[100] == 300
+        prog = ti.get_runtime().prog
+        misses = prog.get_kernel_cache_misses()
+        ti.reset()
+        return misses
+
+    run()
+    # Task names do not depend on the order the workers compile them in, so
+    # the second run finds every module in the cache
+    assert run() == 0
+
+    shutil.rmtree(path)
+
+def test_kernel_cache_invalidation():
+    path = tempfile.mkdtemp()
+    stale = os.path.join(path, 'stale.o')
+    with open(stale, 'w') as f:
+        f.write('garbage')
+    with open(os.path.join(path, 'version'), 'w') as f:
+        f.write('an old version')
+
+    ti.init(arch=ti.cpu, kernel_cache=True, kernel_cache_path=path)
+    x = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def inc():
+        x[None] += 1
+
+    inc()
+    assert x[None] == 1
+    ti.reset()
+    assert not os.path.exists(stale)
+
+    shutil.rmtree(path)
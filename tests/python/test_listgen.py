@@ -58,3 +58,32 @@ def test_nested_3d():
     for _ in range(1000):
         i, j, k = randrange(n), randrange(n), randrange(n)
         assert x[i, j, k] == (i * n + j) * n + k
+
+
+@ti.archs_support_sparse
+def test_nested_pointer_listgen():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+    n = 32
+
+    ti.root.pointer(ti.ij, 4).pointer(ti.ij, 8).dense(ti.ij, 4).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n * 4, n * 4):
+            if (i // 4 + j // 4) % 3 == 0:
+                x[i, j] = 1
+
+    @ti.kernel
+    def count():
+        for i, j in x:
+            s[None] += 1
+
+    activate()
+    count()
+    num_active_blocks = 0
+    for i in range(n):
+        for j in range(n):
+            num_active_blocks += (i + j) % 3 == 0
+    assert s[None] == num_active_blocks * 16
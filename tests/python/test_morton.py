@@ -0,0 +1,56 @@
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_morton_dense_read_write():
+    x = ti.field(ti.i32)
+    n = 16
+    ti.root.dense(ti.ij, n, morton=True).place(x)
+
+    @ti.kernel
+    def fill():
+        for i, j in ti.ndrange(n, n):
+            x[i, j] = i * 100 + j
+
+    fill()
+    for i in range(n):
+        for j in range(n):
+            assert x[i, j] == i * 100 + j
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_morton_struct_for():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+    ti.root.dense(ti.ijk, 2).dense(ti.ijk, (4, 8, 2), morton=True).place(x)
+
+    @ti.kernel
+    def fill():
+        for i, j, k in x:
+            x[i, j, k] = i * 10000 + j * 100 + k
+            s[None] += 1
+
+    fill()
+    assert s[None] == 8 * 16 * 4
+    for i in range(8):
+        for j in range(16):
+            for k in range(4):
+                assert x[i, j, k] == i * 10000 + j * 100 + k
+
+
+@ti.test(require=ti.extension.sparse, arch=[ti.cpu, ti.cuda])
+def test_morton_sparse_parent():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+    ti.root.pointer(ti.ij, 4).dense(ti.ij, 8, morton=True).place(x)
+
+    x[3, 5] = 1
+    x[20, 30] = 2
+
+    @ti.kernel
+    def count():
+        for i, j in x:
+            s[None] += x[i, j] * 1000 + 1
+
+    count()
+    assert s[None] == 2 * 64 + 3000
@@ -0,0 +1,46 @@
+import numpy as np
+
+import taichi as ti
+
+
+def run_multi_offload_kernel(**kwargs):
+    ti.init(arch=ti.cpu, **kwargs)
+    n = 64
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    total = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def multi_offload():
+        for i in x:
+            x[i] = i + ti.random()
+        s = 0.0
+        for i in range(n):
+            s += x[i]
+        total[None] = s
+        for i in y:
+            y[i] = x[i] * 2 + ti.random()
+        for i in range(n):
+            total[None] += y[i]
+
+    multi_offload()
+    ret = x.to_numpy(), y.to_numpy(), total[None]
+    ti.reset()
+    return ret
+
+
+def test_parallel_compile_matches_serial():
+    for counter_based in [False, True]:
+        serial = run_multi_offload_kernel(num_compile_threads=1,
+                                          random_counter_based=counter_based,
+                                          random_seed=1)
+        parallel = run_multi_offload_kernel(num_compile_threads=4,
+                                            random_counter_based=counter_based,
+                                            random_seed=1)
+        if counter_based:
+            # Streams do not depend on how the tasks are compiled
+            assert (serial[0] == parallel[0]).all()
+            assert (serial[1] == parallel[1]).all()
+        else:
+            assert (parallel[0] >= np.arange(64)).all()
+        assert abs(parallel[2] - parallel[0].sum() - parallel[1].sum()) < 1e-2
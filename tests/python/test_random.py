@@ -114,3 +114,94 @@ def test_random_f64():
         return ti.random(dtype=ti.f64)
 
     foo()
+
+
+@ti.test(arch=ti.cpu)
+def test_random_counter_based_thread_independent():
+    n = 1000
+    results = []
+    for num_threads in [1, 3, 8]:
+        ti.init(arch=ti.cpu,
+                random_counter_based=True,
+                cpu_max_num_threads=num_threads)
+        x = ti.field(ti.f32, shape=n)
+        y = ti.field(ti.i32, shape=(n, 4))
+
+        @ti.kernel
+        def gen():
+            for i in x:
+                x[i] = ti.random()
+            for i in range(n):
+                for j in range(4):
+                    y[i, j] = ti.random(ti.i32)
+
+        gen()
+        gen()
+        results.append((x.to_numpy(), y.to_numpy()))
+
+    for X, Y in results[1:]:
+        assert (X == results[0][0]).all()
+        assert (Y == results[0][1]).all()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], random_counter_based=True)
+def test_random_counter_based_dist():
+    n = 1024
+    x = ti.field(ti.f32, shape=(n, n))
+    y = ti.field(ti.f32, shape=10)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            for j in range(n):
+                x[i, j] = ti.random()
+
+    @ti.kernel
+    def gen_serial():
+        for i in range(10):
+            y[i] = ti.random()
+
+    fill()
+    X = x.to_numpy()
+    for i in range(4):
+        assert (X**i).mean() == approx(1 / (i + 1), rel=1e-2)
+
+    # Numbers differ within a serial loop and between launches
+    gen_serial()
+    Y0 = y.to_numpy()
+    gen_serial()
+    Y1 = y.to_numpy()
+    assert len(set(Y0)) == 10
+    assert (Y0 != Y1).all()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], random_counter_based=True)
+def test_random_counter_based_large_sparse_domain():
+    # 2^40 cells, so that linearizing the coordinates in 32 bits would map
+    # (i, j) and (i + 4096, j) to the same random stream
+    n = 1024
+    x = ti.field(ti.i64)
+    block = ti.root.pointer(ti.ij, n)
+    block.dense(ti.ij, n).place(x)
+    count = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def activate():
+        x[0, 0] = 0
+        x[4 * n, 0] = 0
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = ti.random(ti.i64)
+
+    @ti.kernel
+    def count_equal():
+        for i, j in ti.ndrange(n, n):
+            if x[i, j] == x[i + 4 * n, j]:
+                count[None] += 1
+
+    activate()
+    fill()
+    count_equal()
+    assert count[None] == 0
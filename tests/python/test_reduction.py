@@ -113,3 +113,38 @@ def test_reduction_different_scale():
     # 1024 and 100000 since OpenGL max threads per group ~= 1792
     for n in [1, 10, 60, 1024, 100000]:
         assert n == func(n)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_reduction_small_blocks():
+    # Many blocks per thread: the thread-local sums must be initialized and
+    # merged exactly once per thread and launch.
+    n = 1024 * 16
+    a = ti.field(ti.i32)
+    ti.root.pointer(ti.i, n // 8).dense(ti.i, 8).place(a)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            a[i] = 1
+
+    @ti.kernel
+    def range_sum() -> ti.i32:
+        s = 0
+        ti.block_dim(4)
+        for i in range(n):
+            s += a[i]
+        return s
+
+    @ti.kernel
+    def struct_sum() -> ti.i32:
+        s = 0
+        ti.block_dim(4)
+        for i in a:
+            s += a[i]
+        return s
+
+    fill()
+    for _ in range(3):
+        assert range_sum() == n
+        assert struct_sum() == n
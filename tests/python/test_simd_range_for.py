@@ -0,0 +1,61 @@
+import numpy as np
+
+import taichi as ti
+
+
+def run_range_for_kernels(simd_width):
+    ti.init(arch=ti.cpu, cpu_simd_width=simd_width)
+    # Not a multiple of any vector width, so that every block has a remainder
+    n = 1003
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    idx = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = i * 0.5
+            idx[i] = (i * 7) % n
+
+    @ti.kernel
+    def gather_with_continue():
+        for i in range(n):
+            if i % 3 == 0:
+                continue
+            y[i] = x[idx[i]] + x[i]
+
+    fill()
+    gather_with_continue()
+    ret = y.to_numpy()
+    ti.reset()
+    return ret
+
+
+def test_simd_range_for():
+    n = 1003
+    x = np.arange(n, dtype=np.float32) * 0.5
+    idx = (np.arange(n) * 7) % n
+    expected = x[idx] + x
+    expected[::3] = 0
+    for simd_width in [0, 1, 4, 8]:
+        assert np.allclose(run_range_for_kernels(simd_width), expected)
+
+
+@ti.test(arch=ti.cpu)
+def test_simd_range_for_reversed():
+    # Gradient kernels run their range-fors in reverse, which takes the
+    # per-index path
+    n = 1003
+    x = ti.field(ti.f32, shape=n, needs_grad=True)
+    loss = ti.field(ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def compute_loss():
+        for i in range(n):
+            loss[None] += x[i] * x[i]
+
+    for i in range(n):
+        x[i] = i * 0.5
+    with ti.Tape(loss):
+        compute_loss()
+    assert np.allclose(x.grad.to_numpy(), np.arange(n) * 1.0)
@@ -61,7 +61,7 @@ def test_require_extensions_2():
     assert ti.cfg.arch in [ti.cpu]
 
 
-@ti.test(arch=[ti.cpu, ti.opengl],
+@ti.test(arch=[ti.opengl, ti.metal],
          require=[ti.extension.sparse, ti.extension.bls])
 def test_require_extensions_2():
     assert ti.cfg.arch in [ti.cuda]
@@ -0,0 +1,41 @@
+import numpy as np
+
+import taichi as ti
+
+
+def test_tiered_compilation():
+    ti.init(arch=ti.cpu,
+            tiered_compilation=True,
+            tiered_compilation_threshold=4)
+    n = 1000
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def inc(k: ti.f32):
+        for i in x:
+            x[i] += ti.sqrt(i * 1.0) * k
+
+    def upgrades():
+        return ti.get_kernel_stats().get_counters().get(
+            'tiered_compilation_upgrades', 0)
+
+    prog = ti.get_runtime().prog
+    base = upgrades()
+
+    # The last of these launches requests the optimized version
+    for _ in range(4):
+        inc(1.0)
+    prog.wait_for_tiered_compilation()
+    assert upgrades() == base
+
+    # The next launch swaps it in, and later launches keep using it
+    inc(1.0)
+    assert upgrades() == base + 1
+    for _ in range(10):
+        inc(1.0)
+    prog.wait_for_tiered_compilation()
+    assert upgrades() == base + 1
+
+    expected = np.sqrt(np.arange(n, dtype=np.float32)) * 15
+    assert np.allclose(x.to_numpy(), expected, rtol=1e-4)
+    ti.reset()